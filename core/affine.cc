@@ -49,7 +49,8 @@ auto Affine::ParamsToMatrix(const ParameterVector& p) -> Transform
 
   H <<
       1.0+p[0], p[1], p[2],
-      p[3], 1.0+p[4], p[5];
+      p[3], 1.0+p[4], p[5],
+      0.0, 0.0, 1.0;
 
   return H;
 }
@@ -74,16 +75,5 @@ auto Affine::ComputeJacobian(float x, float y, float Ix, float Iy,
   return J;
 }
 
-auto Affine::ComputeWarpJacobian(float x, float y, float s, float c1, float c2)
-  -> WarpJacobian
-{
-  WarpJacobian Jw;
-  Jw <<
-      x - c1, y - c2, 1.0f/s,   0.0f,   0.0f,   0.0f,
-      0.0f,     0.0f,    0.0, x - c1, y - c2,  1.0f/s;
-
-  return Jw;
-}
-
 } // bp
 
@@ -52,6 +52,14 @@ class Affine : public MotionModel<Affine>
    */
   static ParameterVector MatrixToParams(const Transform&);
 
+  /**
+   * \return the norm of the parameters of the matrix
+   */
+  static inline float ParamsNorm(const Transform& T)
+  {
+    return MatrixToParams(T).norm();
+  }
+
   /**
    * solve the linear system
    */
@@ -69,8 +77,8 @@ class Affine : public MotionModel<Affine>
     J = Affine::ComputeJacobian(x, y, Ix, Iy, s, c1, c2);
   }
 
-  static WarpJacobian ComputeWarpJacobian(float x, float y, float s = 1.0,
-                                          float c1 = 0.0, float c2 = 0.0);
+  static inline WarpJacobian ComputeWarpJacobian(float x, float y, float s = 1.0,
+                                                 float c1 = 0.0, float c2 = 0.0);
 
   static inline void ComputeWarpJacobian(Eigen::Ref<WarpJacobian> Jw, float x, float y,
                                          float s = 1.0f, float c1 = 0.0f, float c2 = 0.0f)
@@ -79,6 +87,17 @@ class Affine : public MotionModel<Affine>
   }
 }; // Affine
 
+inline auto Affine::ComputeWarpJacobian(float x, float y, float s, float c1, float c2)
+  -> WarpJacobian
+{
+  WarpJacobian Jw;
+  Jw <<
+      x - c1, y - c2, 1.0f/s,   0.0f,   0.0f,   0.0f,
+      0.0f,     0.0f,   0.0f, x - c1, y - c2, 1.0f/s;
+
+  return Jw;
+}
+
 }; // bp
 
 #endif // BITPLANES_CORE_AFFINE_H
@@ -19,11 +19,41 @@
 #include "bitplanes/core/debug.h"
 #include "bitplanes/utils/config_file.h"
 #include "bitplanes/utils/icompare.h"
+#include "bitplanes/utils/str2num.h"
 
 #include <iostream>
 
 namespace bp {
 
+/**
+ * the motion schedule is a comma separated list of motion types, e.g.
+ * "Translation,Affine"
+ */
+static std::string MotionScheduleToString(
+    const std::vector<AlgorithmParameters::MotionType>& schedule)
+{
+  std::string ret;
+  for(size_t i = 0; i < schedule.size(); ++i)
+    ret += (i ? "," : "") + ToString(schedule[i]);
+
+  return ret;
+}
+
+static std::vector<AlgorithmParameters::MotionType>
+MotionScheduleFromString(std::string str)
+{
+  std::vector<AlgorithmParameters::MotionType> ret;
+  for(const auto& token : splitstr(str, ','))
+  {
+    // "Translation, Affine" is as good as "Translation,Affine"
+    const auto b = token.find_first_not_of(" \t"), e = token.find_last_not_of(" \t");
+    if(b != std::string::npos)
+      ret.push_back(MotionTypeFromString(token.substr(b, e - b + 1)));
+  }
+
+  return ret;
+}
+
 AlgorithmParameters AlgorithmParameters::FromConfigFile(std::string filename)
 {
   AlgorithmParameters ret;
@@ -42,6 +72,7 @@ bool AlgorithmParameters::load(std::string filename)
     ConfigFile cf(filename);
 
     num_levels = cf.get<int>("NumLevels", -1);
+    expected_motion = cf.get<float>("ExpectedMotion", 8.0f);
     max_iterations = cf.get<int>("MaxIterations", 50);
     parameter_tolerance = cf.get<float>("ParameterTolerance", 1e-5f);
     function_tolerance = cf.get<float>("FunctionTolerance", 1e-5f);
@@ -51,7 +82,15 @@ bool AlgorithmParameters::load(std::string filename)
     cf.get<std::string>("MultiChannelExtractorType", "BitPlanes"));
     linearizer = LinearizerTypeFromString(
         cf.get<std::string>("LinearizerType", "InverseCompositional"));
+    motion_type = MotionTypeFromString(
+        cf.get<std::string>("MotionType", "Homography"));
+    motion_schedule = MotionScheduleFromString(
+        cf.get<std::string>("MotionSchedule", ""));
     subsampling = cf.get<int>("Subsampling", 1);
+    template_storage = TemplateStorageFromString(
+        cf.get<std::string>("TemplateStorage", "Dense"));
+    max_template_pixels = cf.get<int>("MaxTemplatePixels", -1);
+    time_budget_ms = cf.get<float>("TimeBudget", -1.0f);
 
   } catch(const std::exception& ex) {
     Warn("Failed to load config from '%s'\n", filename.c_str());
@@ -69,14 +108,23 @@ bool AlgorithmParameters::save(std::string filename)
 
     cf
         ("MultiChannelExtractorType", ToString(multi_channel_function))
-        ("LinearizerType", ToString(linearizer)).set
+        ("LinearizerType", ToString(linearizer))
+        ("MotionType", ToString(motion_type))
+        ("TemplateStorage", ToString(template_storage)).set
         ("NumLevels", num_levels).set
+        ("ExpectedMotion", expected_motion).set
         ("MaxIterations", max_iterations).set
         ("ParameterTolerance", parameter_tolerance).set
         ("FunctionTolerance", function_tolerance).set
         ("Sigma", sigma).set
         ("Verbose", verbose).set
-        ("Subsampling", subsampling);
+        ("Subsampling", subsampling).set
+        ("MaxTemplatePixels", max_template_pixels).set
+        ("TimeBudget", time_budget_ms);
+
+    // the config file has no empty values
+    if(!motion_schedule.empty())
+      cf("MotionSchedule", MotionScheduleToString(motion_schedule));
 
     cf.save(filename);
   } catch(const std::exception& ex) {
@@ -91,12 +139,19 @@ bool AlgorithmParameters::save(std::string filename)
 std::ostream& operator<<(std::ostream& os, const AlgorithmParameters& p)
 {
   os << "MultiChannelFunction = " << ToString(p.multi_channel_function) << "\n";
+  os << "LinearizerType = " << ToString(p.linearizer) << "\n";
+  os << "MotionType = " << ToString(p.motion_type) << "\n";
+  os << "MotionSchedule = " << MotionScheduleToString(p.motion_schedule) << "\n";
   os << "ParameterTolerance = " << p.parameter_tolerance << "\n";
   os << "FunctionTolerance = " << p.function_tolerance << "\n";
   os << "NumLevels = " << p.num_levels << "\n";
+  os << "ExpectedMotion = " << p.expected_motion << "\n";
   os << "sigma = " << p.sigma << "\n";
   os << "verbose = " << p.verbose << "\n";
-  os << "subsampling = " << p.subsampling;
+  os << "subsampling = " << p.subsampling << "\n";
+  os << "TemplateStorage = " << ToString(p.template_storage) << "\n";
+  os << "MaxTemplatePixels = " << p.max_template_pixels << "\n";
+  os << "TimeBudget = " << p.time_budget_ms;
   return os;
 }
 
@@ -172,6 +227,10 @@ std::string ToString(AlgorithmParameters::LinearizerType t)
     case AlgorithmParameters::LinearizerType::ForwardCompositional:
       ret = "ForwardCompositional";
       break;
+
+    case AlgorithmParameters::LinearizerType::ESM:
+      ret = "ESM";
+      break;
   }
 
   return ret;
@@ -184,12 +243,87 @@ LinearizerTypeFromString(std::string name)
     return AlgorithmParameters::LinearizerType::InverseCompositional;
   else if(icompare("ForwardCompositional", name) || icompare("FC", name))
     return AlgorithmParameters::LinearizerType::ForwardCompositional;
+  else if(icompare("ESM", name) || icompare("EfficientSecondOrder", name))
+    return AlgorithmParameters::LinearizerType::ESM;
   else
     Warn("Unknown LinearizerType '%s'\n", name.c_str());
 
   return AlgorithmParameters::LinearizerType::InverseCompositional;
 }
 
+std::string ToString(AlgorithmParameters::MotionType t)
+{
+  std::string ret;
+
+  switch(t)
+  {
+    case AlgorithmParameters::MotionType::Translation:
+      ret = "Translation";
+      break;
+
+    case AlgorithmParameters::MotionType::Affine:
+      ret = "Affine";
+      break;
+
+    case AlgorithmParameters::MotionType::Homography:
+      ret = "Homography";
+      break;
+  }
+
+  return ret;
+}
+
+AlgorithmParameters::MotionType
+MotionTypeFromString(std::string name)
+{
+  if(icompare("Translation", name))
+    return AlgorithmParameters::MotionType::Translation;
+  else if(icompare("Affine", name))
+    return AlgorithmParameters::MotionType::Affine;
+  else if(icompare("Homography", name))
+    return AlgorithmParameters::MotionType::Homography;
+  else
+    Warn("Unknown MotionType '%s'\n", name.c_str());
+
+  return AlgorithmParameters::MotionType::Homography;
+}
+
+std::string ToString(AlgorithmParameters::TemplateStorage t)
+{
+  std::string ret;
+
+  switch(t)
+  {
+    case AlgorithmParameters::TemplateStorage::Dense:
+      ret = "Dense";
+      break;
+
+    case AlgorithmParameters::TemplateStorage::Compact:
+      ret = "Compact";
+      break;
+
+    case AlgorithmParameters::TemplateStorage::Census:
+      ret = "Census";
+      break;
+  }
+
+  return ret;
+}
+
+AlgorithmParameters::TemplateStorage
+TemplateStorageFromString(std::string name)
+{
+  if(icompare("Dense", name))
+    return AlgorithmParameters::TemplateStorage::Dense;
+  else if(icompare("Compact", name))
+    return AlgorithmParameters::TemplateStorage::Compact;
+  else if(icompare("Census", name))
+    return AlgorithmParameters::TemplateStorage::Census;
+  else
+    Warn("Unknown TemplateStorage '%s'\n", name.c_str());
+
+  return AlgorithmParameters::TemplateStorage::Dense;
+}
 
 } // bp
 
@@ -20,6 +20,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 namespace bp {
 
@@ -50,6 +51,7 @@ struct AlgorithmParameters
   {
     InverseCompositional, //< IC algorithm
     ForwardCompositional, //< FC algorithm
+    ESM,                  //< Efficient Second-order Minimization
   }; // LinearizerType
 
   /**
@@ -62,13 +64,31 @@ struct AlgorithmParameters
     Homography
   }; // MotionType
 
+  /**
+   * How the template data is stored
+   */
+  enum class TemplateStorage
+  {
+    Dense,   //< full 8N x DOF Jacobian matrix is precomputed
+    Compact, //< only the channel gradient signs, Jacobians are recomputed
+    Census   //< only the census signatures (ForwardCompositional)
+  }; // TemplateStorage
 
   /**
    * number of pyramid levels. A negative value means 'Auto'
    * A value of 1 means a single level (no pyramid)
+   *
+   * In 'Auto' mode, the number of levels is chosen from the template size,
+   * MIN_NUM_PIXELS_TO_WORK and 'expected_motion' (see AutoPyramidLevels)
    */
   int num_levels = -1;
 
+  /**
+   * expected magnitude of the inter-frame motion of the template in pixels.
+   * Used to select the number of pyramid levels in 'Auto' mode
+   */
+  float expected_motion = 8.0f;
+
   /**
    * maximum number of iterations
    */
@@ -119,11 +139,76 @@ struct AlgorithmParameters
   /**
    * linearization algorithm
    *
-   * NOTE: this is the only linearizer supported. In the future, we will add
-   * more linearizers (e.g. ForwardCompositional, and ESM)
+   * 'InverseCompositional' uses the template Jacobian and a Hessian that is
+   * factorized once. 'ESM' averages the template and the warped image channel
+   * gradients, and solves with a new Hessian every iteration. It usually needs
+   * fewer iterations and converges from farther away, at a higher cost per
+   * iteration. ESM templates always use the compact storage.
+   *
+   * 'ForwardCompositional' takes the gradients from the warped image only, and
+   * solves with a new Hessian every iteration. The template is just the census
+   * signatures (Census storage), which makes setTemplate nearly free. Use it
+   * when the template changes every few frames, and IC for long-lived
+   * templates
    */
   LinearizerType linearizer = LinearizerType::InverseCompositional;
 
+  /**
+   * motion model to estimate.
+   *
+   * The trackers are templates on the motion model, the application picks the
+   * instantiation (Homography, Affine or Translation) from this value. A
+   * Translation (2 DOF) or Affine (6 DOF) template is cheaper to build and to
+   * track than a Homography (8 DOF) when it describes the motion of the target.
+   * The template model sets it to the model it was instantiated with
+   */
+  MotionType motion_type = MotionType::Homography;
+
+  /**
+   * motion models of the pyramid levels, starting at the coarsest.
+   *
+   * For example, {Translation, Affine} estimates a translation at the coarsest
+   * level and an affine motion at the next one. The other levels, and always
+   * the finest, estimate the model of the tracker. A model with more DOF than
+   * the tracker is replaced by the tracker's. The coarse levels then cost less
+   * and are better conditioned, and the finer levels start closer to the
+   * solution. Empty means the model of the tracker at all levels
+   */
+  std::vector<MotionType> motion_schedule;
+
+  /**
+   * template storage.
+   *
+   * 'Dense' stores the Jacobian of every channel (8*DOF floats per pixel).
+   * 'Compact' stores 4 bytes of gradient codes per pixel and recomputes the
+   * warp Jacobian during linearization, which uses much less memory for large
+   * templates. 'Census' stores only the census signatures and is set by the
+   * ForwardCompositional linearizer
+   */
+  TemplateStorage template_storage = TemplateStorage::Dense;
+
+  /**
+   * maximum number of template pixels to use (per pyramid level).
+   *
+   * Pixels with a zero gradient in all channels are always discarded. If more
+   * than 'max_template_pixels' remain, we keep the ones with the largest
+   * contribution to the Hessian. A value <= 0 means no limit
+   */
+  int max_template_pixels = -1;
+
+  /**
+   * time budget of a call to track, in milliseconds. A value <= 0 means no
+   * limit.
+   *
+   * When the budget runs out the iterations stop, and the transform with the
+   * lowest residual so far is returned with the status TimeBudgetExceeded. A
+   * level always makes its first update, hence a call may overrun by about an
+   * iteration. The pyramid tracker gives each level an equal share of the time
+   * left, the time a level does not use goes to the finer levels, and the
+   * levels left when the budget runs out are skipped
+   */
+  float time_budget_ms = -1.0f;
+
   /**
    * loads the configurations from a config file
    */
@@ -166,6 +251,26 @@ std::string ToString(AlgorithmParameters::LinearizerType);
 AlgorithmParameters::LinearizerType
 LinearizerTypeFromString(std::string);
 
+/**
+ * converts MotionType to string
+ */
+std::string ToString(AlgorithmParameters::MotionType);
+
+/**
+ */
+AlgorithmParameters::MotionType
+MotionTypeFromString(std::string);
+
+/**
+ * converts TemplateStorage to string
+ */
+std::string ToString(AlgorithmParameters::TemplateStorage);
+
+/**
+ */
+AlgorithmParameters::TemplateStorage
+TemplateStorageFromString(std::string);
+
 }; // bp
 
 #endif // BITPLANES_CORE_ALGORITHM_PARAMETERS_H
@@ -24,6 +24,7 @@
 #include "bitplanes/core/motion_model.h"
 #include "bitplanes/core/internal/bitplanes_channel_data_base.h"
 #include "bitplanes/core/internal/bitplanes_channel_data_subsampled.h"
+#include "bitplanes/core/template_model.h"
 #include <opencv2/core.hpp>
 
 #include <limits>
@@ -50,6 +51,9 @@ class BitplanesTracker
 
   typedef BitPlanesChannelDataSubSampled<M> ChannelDataType;
 
+  typedef TemplateModel<M> ModelType;
+  typedef typename ModelType::Pointer ModelPointer;
+
  public:
   /**
    */
@@ -64,37 +68,69 @@ class BitplanesTracker
   void setTemplate(const cv::Mat& image, const cv::Rect& bbox);
 
   /**
-   * Tracks the template that was set during the call setTemplate
+   * Tracks the template that was set during the call setTemplate. The buffers
+   * are allocated by setTemplate and reused, hence tracking images of the same
+   * size as the template image does not allocate
    *
    * \param image the input image (I_1)
    * \param T_init initialization of the transform
+   *
+   * Uses the time budget of the AlgorithmParameters
    */
-  Result track(const cv::Mat& image, const Transform& T_init = Transform::Identity());
+  inline Result track(const cv::Mat& image, const Transform& T_init = Transform::Identity())
+  {
+    return track(image, T_init, _alg_params.time_budget_ms);
+  }
+
+  /**
+   * Tracks the template within 'time_budget_ms' milliseconds (see bp::track)
+   */
+  Result track(const cv::Mat& image, const Transform& T_init, float time_budget_ms);
+
+  /**
+   * Uses the level 'level' of 'pyr' as the pre-smoothed image. The pyramid
+   * computes the smoothed image in the regions we need, and the images passed
+   * to setTemplate and track are only used for their size.
+   *
+   * The pyramid must outlive the tracker, or be unset with a nullptr
+   */
+  inline void setImagePyramid(ImagePyramid* pyr, int level = 0)
+  {
+    _workspace.setImagePyramid(pyr, level);
+  }
 
- protected:
   /**
-   * Performs the linearization step, which is:
-   *  - warp the image
-   *  - re-compute the multi-channel descriptors
-   *  - compute the cost function gradient (J^T * error)
+   * \return the bounding box of the template warped with T, with a margin for
+   * the census neighborhood and the bilinear interpolation. The box is clipped
+   * to the image
    */
-  float linearize(const cv::Mat&, const Transform& T_init);
+  inline cv::Rect templateFootprint(const Transform& T, const cv::Size& image_size) const
+  {
+    return _model->footprint(T, image_size);
+  }
 
   /**
-   * applies smoothing to the image at the specified ROI
+   * \return the template model, valid after setTemplate. The model may be
+   * shared with other trackers (see bp::track)
+   */
+  inline const ModelPointer& model() const { return _model; }
+
+  /**
+   * Uses a model that was built elsewhere, instead of setTemplate
+   *
+   * \param model the template model
+   * \param image_size size of the images to track, used to allocate the buffers
    */
-  void smoothImage(cv::Mat& I, const cv::Rect& roi);
+  inline void setModel(const ModelPointer& model, const cv::Size& image_size)
+  {
+    _model = model;
+    _workspace.reserve(*_model, image_size);
+  }
 
  protected:
   AlgorithmParameters _alg_params; //< AlgorithmParameters
-  ChannelDataType _cdata;          //< holds the multi-channel data
-  cv::Rect _bbox;                  //< the template's bounding box
-  cv::Mat _I, _Iw;                 //< buffers for input image and warped image
-  Matrix33f _T, _T_inv;            //< normalization matrices
-  Gradient _gradient;              //< gradient of the cost function
-  Vector_<float> _residuals;       //< vector of residuals
-  Solver _solver;                  //< the linear solver
-  int _interp;                     //< interpolation, e.g. cv::INTER_LINEAR
+  ModelPointer _model;             //< the template, set by setTemplate
+  TrackingWorkspace<M> _workspace; //< buffers used by track
 
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
@@ -16,13 +16,29 @@
 */
 
 #include <bitplanes/core/bitplanes_tracker_pyramid.h>
+#include <bitplanes/core/config.h>
 #include <bitplanes/core/homography.h>
+#include <bitplanes/core/affine.h>
+#include <bitplanes/core/translation.h>
 #include <bitplanes/core/debug.h>
+#include <bitplanes/core/internal/binary_io.h>
 #include <bitplanes/utils/error.h>
+#include <bitplanes/utils/mapped_file.h>
 
 #include <opencv2/imgproc.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 #include <iostream>
+#include <vector>
+
+#if BITPLANES_WITH_TBB
+#include <tbb/parallel_for.h>
+#endif
 
 namespace bp {
 
@@ -37,11 +53,46 @@ AlgorithmParameters ReduceAlgorithmParameters(AlgorithmParameters p)
   return p;
 }
 
+int AutoPyramidLevels(const cv::Size& template_size, const AlgorithmParameters& p)
+{
+  //
+  // the iterations converge reliably when the template is within a couple of
+  // pixels of the solution. The coarsest level sees the motion divided by
+  // 2^(L-1)
+  //
+  constexpr float ConvergenceRadius = 2.0f;
+
+  // the template must keep a few pixels inside the census border
+  constexpr int MinTemplateDim = 8;
+
+  const int s = std::max(1, p.subsampling);
+
+  int n_levels = 1;
+  for(cv::Size sz = template_size; ; ++n_levels)
+  {
+    const float motion = p.expected_motion / (1 << (n_levels - 1));
+    if(motion <= ConvergenceRadius)
+      break;
+
+    sz = cv::Size(sz.width / 2, sz.height / 2);
+    const int n_pixels = (sz.width / s) * (sz.height / s);
+    if(std::min(sz.width, sz.height) < MinTemplateDim ||
+       n_pixels < AlgorithmParameters::MIN_NUM_PIXELS_TO_WORK)
+      break;
+  }
+
+  return n_levels;
+}
+
 static inline
 std::vector<AlgorithmParameters>
-MakeAlgorithmParametersPyramid(AlgorithmParameters p)
+MakeAlgorithmParametersPyramid(AlgorithmParameters p, const cv::Rect& bbox)
 {
-  THROW_ERROR_IF(p.num_levels < 1, "auto pyramid levels not implemented");
+  if(p.num_levels < 1) {
+    p.num_levels = AutoPyramidLevels(bbox.size(), p);
+    if(p.verbose)
+      printf("Auto pyramid levels: %d\n", p.num_levels);
+  }
 
   std::vector<AlgorithmParameters> ret(p.num_levels);
   ret[0] = p;
@@ -52,47 +103,324 @@ MakeAlgorithmParametersPyramid(AlgorithmParameters p)
   return ret;
 }
 
+static inline int MotionTypeDOF(AlgorithmParameters::MotionType t)
+{
+  switch(t)
+  {
+    case AlgorithmParameters::MotionType::Translation: return Translation::DOF;
+    case AlgorithmParameters::MotionType::Affine: return Affine::DOF;
+    case AlgorithmParameters::MotionType::Homography: return Homography::DOF;
+  }
+
+  return Homography::DOF;
+}
+
+/**
+ * \return the DOF of the model at each level, from the finest, for a tracker
+ * of 'dof' parameters
+ */
+static inline std::vector<int>
+MakeLevelDOF(const AlgorithmParameters& p, int n_levels, int dof)
+{
+  std::vector<int> ret(n_levels, dof);
+
+  // the schedule starts at the coarsest level, the finest uses the tracker model
+  const int n = std::min(static_cast<int>(p.motion_schedule.size()), n_levels - 1);
+  for(int k = 0; k < n; ++k)
+    ret[n_levels - 1 - k] = std::min(dof, MotionTypeDOF(p.motion_schedule[k]));
+
+  return ret;
+}
+
+namespace {
+
+/**
+ * The level tracker for the motion model L
+ */
+template <class L>
+class LevelTracker : public PyramidLevelTracker
+{
+  typedef BitplanesTracker<L> Tracker;
+
+ public:
+  explicit LevelTracker(const AlgorithmParameters& p) : _tracker(p) {}
+
+  LevelTracker(const typename Tracker::ModelPointer& model, const cv::Size& image_size)
+      : _tracker(model->parameters())
+  {
+    _tracker.setModel(model, image_size);
+  }
+
+  virtual UniquePointer<PyramidLevelTracker> clone() const
+  {
+    return bp::make_unique<LevelTracker>(*this);
+  }
+
+  virtual int dof() const { return L::DOF; }
+
+  virtual void setTemplate(const cv::Mat& I, const cv::Rect& bbox)
+  {
+    _tracker.setTemplate(I, bbox);
+  }
+
+  //
+  // the updates are composed with the full 3x3 transform, hence the pose of a
+  // coarser level, whatever its model, is the initialization of the next one
+  //
+  virtual Result track(const cv::Mat& I, const Transform& T, float time_budget_ms)
+  {
+    return _tracker.track(I, T, time_budget_ms);
+  }
+
+  virtual cv::Rect templateFootprint(const Transform& T, const cv::Size& image_size) const
+  {
+    return _tracker.templateFootprint(T, image_size);
+  }
+
+  virtual void setImagePyramid(ImagePyramid* pyr, int level)
+  {
+    _tracker.setImagePyramid(pyr, level);
+  }
+
+  virtual void write(BinaryWriter& writer) const
+  {
+    _tracker.model()->write(writer);
+  }
+
+ private:
+  Tracker _tracker;
+
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+}; // LevelTracker
+
+/**
+ * \return the tracker of a level with a model of 'dof' parameters
+ */
+static inline UniquePointer<PyramidLevelTracker>
+MakeLevelTracker(int dof, const AlgorithmParameters& p)
+{
+  switch(dof)
+  {
+    case Translation::DOF: return bp::make_unique<LevelTracker<Translation>>(p);
+    case Affine::DOF: return bp::make_unique<LevelTracker<Affine>>(p);
+    default: return bp::make_unique<LevelTracker<Homography>>(p);
+  }
+}
+
+/**
+ * \return the tracker of a level, with the model of 'dof' parameters read
+ * from 'reader' (see TemplateModel::Read). 'sigma' is set to the pre-smoothing
+ * of the level
+ */
+static inline UniquePointer<PyramidLevelTracker>
+ReadLevelTracker(int dof, BinaryReader& reader, const AlgorithmParameters& p,
+                 const cv::Size& image_size, float& sigma)
+{
+  switch(dof)
+  {
+    case Translation::DOF: {
+      auto model = TemplateModel<Translation>::Read(reader, p);
+      sigma = model->parameters().sigma;
+      return bp::make_unique<LevelTracker<Translation>>(model, image_size);
+    }
+    case Affine::DOF: {
+      auto model = TemplateModel<Affine>::Read(reader, p);
+      sigma = model->parameters().sigma;
+      return bp::make_unique<LevelTracker<Affine>>(model, image_size);
+    }
+    default: {
+      auto model = TemplateModel<Homography>::Read(reader, p);
+      sigma = model->parameters().sigma;
+      return bp::make_unique<LevelTracker<Homography>>(model, image_size);
+    }
+  }
+}
+
+} // namespace
+
+template <class M>
+BitPlanesTrackerPyramid<M>::BitPlanesTrackerPyramid(const BitPlanesTrackerPyramid& other)
+  : _alg_params(other._alg_params), _level_dof(other._level_dof),
+    _sigmas(other._sigmas), _image_size(other._image_size),
+    _image_pyramid(other._image_pyramid), _T_init(other._T_init)
+{
+  for(const auto& level : other._levels)
+    _levels.push_back( level->clone() );
+
+  // the workspaces of the clones point at the pyramid of 'other'
+  setImagePyramid(&_image_pyramid);
+}
+
+template <class M>
+BitPlanesTrackerPyramid<M>::BitPlanesTrackerPyramid(BitPlanesTrackerPyramid&& other)
+  : _alg_params(std::move(other._alg_params)), _levels(std::move(other._levels)),
+    _level_dof(std::move(other._level_dof)), _sigmas(std::move(other._sigmas)),
+    _image_size(other._image_size), _image_pyramid(std::move(other._image_pyramid)),
+    _T_init(other._T_init)
+{
+  setImagePyramid(&_image_pyramid);
+}
+
+template <class M> BitPlanesTrackerPyramid<M>&
+BitPlanesTrackerPyramid<M>::operator=(const BitPlanesTrackerPyramid& other)
+{
+  if(this != &other)
+    *this = BitPlanesTrackerPyramid(other);
+
+  return *this;
+}
+
+template <class M> BitPlanesTrackerPyramid<M>&
+BitPlanesTrackerPyramid<M>::operator=(BitPlanesTrackerPyramid&& other)
+{
+  if(this != &other) {
+    _alg_params = std::move(other._alg_params);
+    _levels = std::move(other._levels);
+    _level_dof = std::move(other._level_dof);
+    _sigmas = std::move(other._sigmas);
+    _image_size = other._image_size;
+    _image_pyramid = std::move(other._image_pyramid);
+    _T_init = other._T_init;
+
+    setImagePyramid(&_image_pyramid);
+  }
+
+  return *this;
+}
+
+template <class M>
+void BitPlanesTrackerPyramid<M>::setImagePyramid(ImagePyramid* pyr)
+{
+  for(int i = 0; i < numLevels(); ++i)
+    _levels[i]->setImagePyramid(pyr, i);
+}
 
 template <class M>
 void BitPlanesTrackerPyramid<M>::setTemplate(const cv::Mat& I, const cv::Rect& bbox)
 {
-  auto alg_params = MakeAlgorithmParametersPyramid(_alg_params);
+  setTemplate(I, bbox, _image_pyramid);
+}
+
+template <class M>
+void BitPlanesTrackerPyramid<M>::setTemplate(const cv::Mat& I, const cv::Rect& bbox,
+                                             ImagePyramid& pyr)
+{
+  auto alg_params = MakeAlgorithmParametersPyramid(_alg_params, bbox);
 
-  cv::Mat I0;
-  I.copyTo(I0);
+  const int n_levels = static_cast<int>(alg_params.size());
+  _level_dof = MakeLevelDOF(_alg_params, n_levels, M::DOF);
 
-  _pyramid.clear();
+  _levels.clear();
+  for(int i = 0; i < n_levels; ++i)
+    _levels.push_back( MakeLevelTracker(_level_dof[i], alg_params[i]) );
+
+  //
+  // the levels are pre-smoothed by the image pyramid, which also allocates
+  // the buffers used by track
+  //
+  _sigmas.resize(alg_params.size());
   for(size_t i = 0; i < alg_params.size(); ++i)
-    _pyramid.push_back( Tracker(alg_params[i]) );
+    _sigmas[i] = alg_params[i].sigma;
 
-  _pyramid[0].setTemplate(I0, bbox);
+  _image_size = I.size();
+  if(pyr.numLevels() < n_levels || pyr.size() != I.size() ||
+     !std::equal(_sigmas.begin(), _sigmas.end(), pyr.sigmas().begin()))
+    pyr.init(I.size(), _sigmas);
+  pyr.setImage(I);
 
-  cv::Rect bbox_copy(bbox);
-  for(size_t i = 1; i < _pyramid.size(); ++i)
+  std::vector<cv::Rect> bboxes(n_levels, bbox);
+  for(int i = 1; i < n_levels; ++i)
   {
-    cv::pyrDown(I0, I0);
-    bbox_copy.x /= 2; bbox_copy.y /= 2;
-    bbox_copy.width /= 2; bbox_copy.height /= 2;
-    _pyramid[i].setTemplate(I0, bbox_copy);
+    bboxes[i] = cv::Rect(bboxes[i-1].x / 2, bboxes[i-1].y / 2,
+                         bboxes[i-1].width / 2, bboxes[i-1].height / 2);
   }
 
+  setImagePyramid(&pyr);
+
+  //
+  // the levels are independent, the image pyramid computes the smoothed
+  // levels under a lock. With TBB, the levels are built concurrently and each
+  // in parallel over its rows. OpenMP does not nest by default, hence there we
+  // build the levels one after the other and only the rows in parallel
+  //
+  auto set_level = [&](int i) {
+    _levels[i]->setTemplate(pyr.level(i), bboxes[i]);
+  };
+
+#if BITPLANES_WITH_TBB
+  tbb::parallel_for(0, n_levels, set_level);
+#else
+  for(int i = 0; i < n_levels; ++i)
+    set_level(i);
+#endif
+
+  pyr.releaseImage();
+
   _T_init.setIdentity();
 }
 
 template <class M>
 Result BitPlanesTrackerPyramid<M>::track(const cv::Mat& I, const Transform& T_init)
 {
-  float s = 1.0f / (1 << (_pyramid.size()-1));
-  Result ret( MotionModelType::Scale(T_init, s) );
+  //
+  // the levels are computed by the trackers on demand, only around the
+  // template. Our pyramid is not allocated if the template was set in a
+  // shared one
+  //
+  if(_image_pyramid.numLevels() < numLevels()) {
+    RecordAllocation();
+    _image_pyramid.init(I.size(), _sigmas);
+  }
+
+  _image_pyramid.setImage(I);
+  const auto ret = track(_image_pyramid, T_init);
+  _image_pyramid.releaseImage();
+
+  return ret;
+}
+
+template <class M>
+Result BitPlanesTrackerPyramid<M>::track(ImagePyramid& pyr, const Transform& T_init)
+{
+  THROW_ERROR_IF( pyr.numLevels() < numLevels(), "not enough pyramid levels" );
 
-  std::vector<cv::Mat> I_pyr(_pyramid.size());
-  I.copyTo(I_pyr[0]);
-  for(size_t i = 1; i < I_pyr.size(); ++i)
-    cv::pyrDown(I_pyr[i-1], I_pyr[i]);
+  typedef std::chrono::steady_clock Clock;
+  const auto t_start = Clock::now();
+  const float time_budget_ms = _alg_params.time_budget_ms;
 
-  for(int i = (int) _pyramid.size() - 1; i >= 0; --i)
+  float s = 1.0f / (1 << (numLevels()-1));
+  Result ret( MotionModelType::Scale(T_init, s) );
+
+  for(int i = numLevels() - 1; i >= 0; --i)
   {
-    ret = _pyramid[i].track(I_pyr[i], ret.T);
+    //
+    // level i gets an equal share of the remaining time among levels i ... 0.
+    // The coarse levels recover most of the motion, with iterations that are
+    // cheap but not in proportion to their number of pixels. They usually
+    // converge early, and the time they do not use goes to the finer levels
+    //
+    float level_budget_ms = -1.0f;
+    if(time_budget_ms > 0.0f)
+    {
+      const float remaining_ms = time_budget_ms -
+          std::chrono::duration<float, std::milli>(Clock::now() - t_start).count();
+      const bool is_coarsest = i == numLevels() - 1;
+      if(remaining_ms <= 0.0f && !is_coarsest) {
+        // out of time, return the pose of the last level at the finest
+        for( ; i > 0; --i)
+          ret.T = MotionModelType::Scale(ret.T, 2.0);
+        ret.status = OptimizerStatus::TimeBudgetExceeded;
+        break;
+      }
+
+      // the coarsest level runs in any case, to make the first update. A
+      // budget <= 0 would mean no limit
+      level_budget_ms = std::max(remaining_ms, 1e-6f) / (i + 1);
+    }
+
+    _levels[i]->setImagePyramid(&pyr, i);
+    ret = _levels[i]->track(pyr.level(i), ret.T, level_budget_ms);
     if(i != 0) ret.T = MotionModelType::Scale(ret.T, 2.0);
   }
 
@@ -100,7 +428,123 @@ Result BitPlanesTrackerPyramid<M>::track(const cv::Mat& I, const Transform& T_in
   return ret;
 }
 
+template <class M>
+void BitPlanesTrackerPyramid<M>::prepare(ImagePyramid& pyr, const Transform& T_init) const
+{
+  THROW_ERROR_IF( pyr.numLevels() < numLevels(), "not enough pyramid levels" );
+
+  for(int i = 0; i < numLevels(); ++i)
+  {
+    //
+    // the template moves by about expected_motion / 2^i pixels at level i,
+    // the iterations that go further use the (locked) lazy path
+    //
+    const float s = 1.0f / (1 << i);
+    const int margin = 2 + static_cast<int>(std::ceil(s * _alg_params.expected_motion));
+
+    const cv::Size size = pyr.level(i).size();
+    cv::Rect roi = _levels[i]->templateFootprint(MotionModelType::Scale(T_init, s), size);
+    roi = cv::Rect(roi.x - margin, roi.y - margin, roi.width + 2*margin,
+                   roi.height + 2*margin) & cv::Rect(cv::Point(0, 0), size);
+
+    pyr.prepare(i, roi);
+  }
+}
+
+namespace {
+
+static const char TemplateFileMagic[8] = {'B', 'P', 'T', 'M', 'P', 'L', 0, 0};
+static const uint32_t TemplateFileVersion = 3;
+static const uint32_t ByteOrderMark = 0x01020304;
+
+/**
+ * The header of the template files. The models of the levels follow, from
+ * the finest to the coarsest, each after its DOF as an int32_t (see
+ * TemplateModel::write). 'dof' is that of the finest level
+ */
+struct TemplateFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  int32_t dof;
+  int32_t num_levels;
+  int32_t image_size[2];
+}; // TemplateFileHeader
+
+} // namespace
+
+template <class M>
+void BitPlanesTrackerPyramid<M>::save(const std::string& filename) const
+{
+  THROW_ERROR_IF( _levels.empty(), "template is not set" );
+
+  TemplateFileHeader h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, TemplateFileMagic, sizeof(h.magic));
+  h.version = TemplateFileVersion;
+  h.byte_order = ByteOrderMark;
+  h.dof = M::DOF;
+  h.num_levels = numLevels();
+  h.image_size[0] = _image_size.width;
+  h.image_size[1] = _image_size.height;
+
+  BinaryWriter writer(filename);
+  writer.write(h);
+  for(int i = 0; i < numLevels(); ++i)
+  {
+    writer.write(static_cast<int32_t>(_level_dof[i]));
+    _levels[i]->write(writer);
+  }
+
+  writer.close();
+}
+
+template <class M>
+void BitPlanesTrackerPyramid<M>::load(const std::string& filename)
+{
+  BinaryReader reader(std::make_shared<const MappedFile>(filename));
+
+  const auto h = reader.read<TemplateFileHeader>();
+  THROW_ERROR_IF( std::memcmp(h.magic, TemplateFileMagic, sizeof(h.magic)),
+                  "not a template file" );
+  THROW_ERROR_IF( h.version != TemplateFileVersion, "unsupported template file version" );
+  THROW_ERROR_IF( h.byte_order != ByteOrderMark, "template file has a different byte order" );
+  THROW_ERROR_IF( h.dof != M::DOF, "template file has a different motion model" );
+  THROW_ERROR_IF( h.num_levels < 1 || h.num_levels > 16 ||
+                  h.image_size[0] < 1 || h.image_size[1] < 1, "invalid template file" );
+
+  std::vector<LevelPointer> levels;
+  std::vector<int> level_dof;
+  std::vector<float> sigmas;
+  cv::Size image_size(h.image_size[0], h.image_size[1]);
+  for(int i = 0; i < h.num_levels; ++i)
+  {
+    const int dof = reader.read<int32_t>();
+    THROW_ERROR_IF( (i == 0 && dof != M::DOF) || dof > M::DOF ||
+                    (dof != M::DOF && dof != Translation::DOF && dof != Affine::DOF),
+                    "invalid template file" );
+
+    float sigma = 0.0f;
+    levels.push_back( ReadLevelTracker(dof, reader, _alg_params, image_size, sigma) );
+    level_dof.push_back(dof);
+    sigmas.push_back(sigma);
+    image_size = cv::Size((image_size.width + 1) / 2, (image_size.height + 1) / 2);
+  }
+
+  _levels.swap(levels);
+  _level_dof.swap(level_dof);
+  _sigmas.swap(sigmas);
+  _image_size = cv::Size(h.image_size[0], h.image_size[1]);
+  _image_pyramid.init(_image_size, _sigmas);
+  setImagePyramid(&_image_pyramid);
+
+  _T_init.setIdentity();
+}
+
 template class BitPlanesTrackerPyramid<Homography>;
+template class BitPlanesTrackerPyramid<Affine>;
+template class BitPlanesTrackerPyramid<Translation>;
 
 }; // bp
 
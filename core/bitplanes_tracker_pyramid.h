@@ -19,15 +19,67 @@
 #define BITPLANES_CORE_BITPLANES_TRACKER_PYRAMID_H
 
 #include <bitplanes/core/bitplanes_tracker.h>
+#include <bitplanes/core/affine.h>
+#include <bitplanes/core/translation.h>
+#include <bitplanes/core/internal/image_pyramid.h>
+#include <string>
 #include <vector>
 #include <iostream>
 
 namespace bp {
 
+/**
+ * \return the number of pyramid levels for a template of size 'template_size'
+ *
+ * We use the fewest levels such that the expected motion (p.expected_motion)
+ * is within the convergence radius of the coarsest level, but stop before the
+ * template has less than MIN_NUM_PIXELS_TO_WORK pixels (after subsampling) at
+ * the coarsest level
+ */
+int AutoPyramidLevels(const cv::Size& template_size, const AlgorithmParameters& p);
+
+/**
+ * The tracker of a level of BitPlanesTrackerPyramid. The coarse levels may
+ * estimate a model with fewer DOF than the pyramid (see
+ * AlgorithmParameters::motion_schedule), the level hides which one
+ */
+class PyramidLevelTracker
+{
+ public:
+  typedef Matrix33f Transform;
+
+ public:
+  virtual ~PyramidLevelTracker() {}
+
+  /**
+   * \return a copy of the level, which shares the template model
+   */
+  virtual UniquePointer<PyramidLevelTracker> clone() const = 0;
+
+  /**
+   * \return the DOF of the motion model of the level
+   */
+  virtual int dof() const = 0;
+
+  /**
+   * see BitplanesTracker
+   */
+  virtual void setTemplate(const cv::Mat& I, const cv::Rect& bbox) = 0;
+  virtual Result track(const cv::Mat& I, const Transform& T, float time_budget_ms) = 0;
+  virtual cv::Rect templateFootprint(const Transform& T, const cv::Size& image_size) const = 0;
+  virtual void setImagePyramid(ImagePyramid* pyr, int level) = 0;
+
+  /**
+   * writes the template model (see TemplateModel::write)
+   */
+  virtual void write(BinaryWriter&) const = 0;
+}; // PyramidLevelTracker
+
 template <class M>
 class BitPlanesTrackerPyramid
 {
   typedef BitplanesTracker<M> Tracker;
+  typedef UniquePointer<PyramidLevelTracker> LevelPointer;
 
  public:
   typedef typename Tracker::Transform Transform;
@@ -44,6 +96,15 @@ class BitPlanesTrackerPyramid
       std::cout << "AlgorithmParameters:\n" << _alg_params << std::endl;
   }
 
+  /**
+   * The copies and the moved trackers use their own image pyramid in track(I)
+   */
+  BitPlanesTrackerPyramid(const BitPlanesTrackerPyramid&);
+  BitPlanesTrackerPyramid& operator=(const BitPlanesTrackerPyramid&);
+
+  BitPlanesTrackerPyramid(BitPlanesTrackerPyramid&&);
+  BitPlanesTrackerPyramid& operator=(BitPlanesTrackerPyramid&&);
+
   inline ~BitPlanesTrackerPyramid() {}
 
   /**
@@ -54,11 +115,26 @@ class BitPlanesTrackerPyramid
    */
   void setTemplate(const cv::Mat&, const cv::Rect& bbox);
 
+  /**
+   * sets the template, using an image pyramid that is shared with other
+   * trackers (see track(ImagePyramid&)) instead of our own. 'pyr' is
+   * re-initialized if it does not have the levels of the template, it may
+   * have more levels
+   *
+   * \param I reference image
+   * \param bbox template location
+   * \param pyr the image pyramid
+   */
+  void setTemplate(const cv::Mat& I, const cv::Rect& bbox, ImagePyramid& pyr);
+
   /**
    * Tracks the template
    *
    * \param I input image
    * \param T pose to use for initialization
+   *
+   * If AlgorithmParameters::time_budget_ms runs out, the pose of the last
+   * level is returned with the status TimeBudgetExceeded
    */
   Result track(const cv::Mat&, const Transform&);
 
@@ -73,9 +149,79 @@ class BitPlanesTrackerPyramid
     return track(I, _T_init);
   }
 
+  /**
+   * Tracks the template in an image pyramid that is shared with other
+   * trackers. The pyramid must have been set with the input image, and have
+   * at least numLevels() levels with the sigmas given by levelSigmas()
+   *
+   * \param pyr the image pyramid
+   * \param T pose to use for initialization
+   */
+  Result track(ImagePyramid& pyr, const Transform& T);
+
+  inline Result track(ImagePyramid& pyr) {
+    return track(pyr, _T_init);
+  }
+
+  /**
+   * Computes the smoothed levels of 'pyr' in the regions that track(pyr, T)
+   * will need, i.e. the template footprint at T with a margin for the expected
+   * motion. After that, several trackers may track in the same pyramid from
+   * different threads
+   */
+  void prepare(ImagePyramid& pyr, const Transform& T) const;
+
+  inline void prepare(ImagePyramid& pyr) const {
+    prepare(pyr, _T_init);
+  }
+
+  /**
+   * Saves the template, all the levels, to a binary file. The file can be
+   * loaded with load() without recomputing the template data. The format
+   * uses the native byte order
+   */
+  void save(const std::string& filename) const;
+
+  /**
+   * Loads a template saved with save(), replacing the current template. The
+   * file is mapped in memory and the Jacobians are used in place, hence the
+   * pages are shared by the processes that load the same file
+   *
+   * The settings that are not stored with the template (e.g. verbose) are
+   * taken from the parameters of the constructor
+   */
+  void load(const std::string& filename);
+
+  /**
+   * \return the number of pyramid levels, valid after setTemplate
+   */
+  inline int numLevels() const { return static_cast<int>(_levels.size()); }
+
+  /**
+   * \return the std. deviation of the pre-smoothing at each level
+   */
+  inline const std::vector<float>& levelSigmas() const { return _sigmas; }
+
+  /**
+   * \return the DOF of the motion model estimated at each level, from the
+   * finest. Valid after setTemplate
+   */
+  inline const std::vector<int>& levelDOF() const { return _level_dof; }
+
+ private:
+  /**
+   * points the workspaces of the levels at 'pyr'
+   */
+  void setImagePyramid(ImagePyramid* pyr);
+
  private:
   AlgorithmParameters _alg_params;
-  std::vector<Tracker> _pyramid;
+  std::vector<LevelPointer> _levels; //< the tracker of each level, from the finest
+  std::vector<int> _level_dof;  //< DOF of the model of each level
+
+  std::vector<float> _sigmas;  //< pre-smoothing at each level
+  cv::Size _image_size;        //< size of the template image
+  ImagePyramid _image_pyramid; //< image pyramid, reused between calls to track(I)
   Transform _T_init = Transform::Identity();
 }; // BitPlanesTrackerPyramid
 
@@ -131,7 +131,7 @@ BitplanesTrackerSparse<M,S>::track(const cv::Mat& I, const Transform& T_init)
     const ParameterVector dp = _solver.solve(_gradient);
 
     const float dp_norm = dp.norm();
-    const float p_norm = MotionModelType::MatrixToParams(ret.T).norm();
+    const float p_norm = MotionModelType::ParamsNorm(ret.T);
 
     has_converged = TestConverged(dp_norm, p_norm, p_tol, g_norm, tol_opt,
                                   rel_factor, sum_sq, old_sum_sq, f_tol,
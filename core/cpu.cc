@@ -0,0 +1,123 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitplanes/core/cpu.h"
+#include "bitplanes/core/debug.h"
+#include "bitplanes/utils/icompare.h"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace bp {
+
+SimdLevel DetectSimdLevel()
+{
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  __builtin_cpu_init();
+
+#if defined(__clang__) || __GNUC__ >= 6
+  if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    return SimdLevel::AVX512;
+#endif
+
+  if(__builtin_cpu_supports("avx2"))
+    return SimdLevel::AVX2;
+
+  if(__builtin_cpu_supports("sse2"))
+    return SimdLevel::SSE2;
+#endif
+
+  return SimdLevel::Scalar;
+}
+
+static inline SimdLevel ClampToCpu(SimdLevel level)
+{
+  static const SimdLevel best = DetectSimdLevel();
+  return static_cast<int>(level) > static_cast<int>(best) ? best : level;
+}
+
+/**
+ * the level at startup, the environment variable BITPLANES_SIMD overrides the
+ * detected level
+ */
+static SimdLevel InitialSimdLevel()
+{
+  const char* env = std::getenv("BITPLANES_SIMD");
+  return env ? ClampToCpu(SimdLevelFromString(env)) : DetectSimdLevel();
+}
+
+static std::atomic<int>& CurrentLevel()
+{
+  static std::atomic<int> level(static_cast<int>(InitialSimdLevel()));
+  return level;
+}
+
+SimdLevel GetSimdLevel()
+{
+  return static_cast<SimdLevel>(CurrentLevel().load(std::memory_order_relaxed));
+}
+
+SimdLevel SetSimdLevel(SimdLevel level)
+{
+  const auto ret = ClampToCpu(level);
+  CurrentLevel().store(static_cast<int>(ret), std::memory_order_relaxed);
+  return ret;
+}
+
+std::string ToString(SimdLevel level)
+{
+  std::string ret;
+
+  switch(level)
+  {
+    case SimdLevel::Scalar:
+      ret = "Scalar";
+      break;
+
+    case SimdLevel::SSE2:
+      ret = "SSE2";
+      break;
+
+    case SimdLevel::AVX2:
+      ret = "AVX2";
+      break;
+
+    case SimdLevel::AVX512:
+      ret = "AVX512";
+      break;
+  }
+
+  return ret;
+}
+
+SimdLevel SimdLevelFromString(std::string name)
+{
+  if(icompare("Scalar", name) || icompare("None", name))
+    return SimdLevel::Scalar;
+  else if(icompare("SSE2", name))
+    return SimdLevel::SSE2;
+  else if(icompare("AVX2", name))
+    return SimdLevel::AVX2;
+  else if(icompare("AVX512", name))
+    return SimdLevel::AVX512;
+  else
+    Warn("Unknown SimdLevel '%s'\n", name.c_str());
+
+  return DetectSimdLevel();
+}
+
+}; // bp
@@ -0,0 +1,72 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_CPU_H
+#define BITPLANES_CORE_CPU_H
+
+#include <string>
+
+namespace bp {
+
+/**
+ * Instruction set used by the vectorized kernels (census, residuals, image
+ * warping and gradient accumulation).
+ *
+ * The level is detected at runtime from the CPU we are running on. It can be
+ * lowered with the environment variable BITPLANES_SIMD (e.g.
+ * BITPLANES_SIMD=sse2) or with SetSimdLevel(), which is useful to benchmark
+ * each implementation
+ */
+enum class SimdLevel
+{
+  Scalar, //< plain C++
+  SSE2,   //< 128-bit vectors
+  AVX2,   //< 256-bit vectors
+  AVX512  //< 512-bit vectors (AVX-512 F and BW)
+}; // SimdLevel
+
+/**
+ * \return the best level supported by the CPU
+ */
+SimdLevel DetectSimdLevel();
+
+/**
+ * \return the level used by the kernels
+ */
+SimdLevel GetSimdLevel();
+
+/**
+ * Sets the level used by the kernels. If the CPU does not support the
+ * requested level, we use the best level that it supports
+ *
+ * \return the level that will be used
+ */
+SimdLevel SetSimdLevel(SimdLevel);
+
+/**
+ * converts SimdLevel to a string
+ */
+std::string ToString(SimdLevel);
+
+/**
+ * converts a string to SimdLevel. Unknown names give the detected level
+ */
+SimdLevel SimdLevelFromString(std::string);
+
+}; // bp
+
+#endif // BITPLANES_CORE_CPU_H
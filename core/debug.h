@@ -29,6 +29,9 @@
 
 #define HIDDEN __attribute__((visibility("hidden")))
 
+/** compile a function for the given instruction set, e.g. TARGET("avx2") */
+#define TARGET(...)         __attribute__((target(__VA_ARGS__)))
+
 #define likely(expr)        __builtin_expect((expr),true)
 #define unlikey(expr)       __builtin_expect((expr),false)
 
@@ -15,12 +15,16 @@
   along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <unsupported/Eigen/MatrixFunctions> // for exp and log
+#include <unsupported/Eigen/MatrixFunctions> // for log
 #include <Eigen/Cholesky>
+#include <Eigen/LU>
 
 #include "bitplanes/core/homography.h"
 #include "bitplanes/core/bpmath.h"
 
+#include <cmath>
+#include <limits>
+
 namespace bp {
 
 
@@ -34,23 +38,13 @@ auto Homography::Scale(const Transform& T, float scale) -> Transform
   return S * T * S_i;
 }
 
-auto Homography::MatrixToParams(const Transform& H) -> ParameterVector
+/**
+ * the parameters from the logarithm of the homography
+ */
+static inline auto LogToParams(const Homography::Transform& L)
+  -> Homography::ParameterVector
 {
-  Transform L = H.log();
-
-  /*
-  ParameterVector p;
-  p[0] = L(0,2);
-  p[1] = L(1,2);
-  p[2] = -L(1,0);
-  p[3] = -3*L(2,2)/2;
-  p[4] = -1*(L(1,1) - p[3]/3);
-  p[5] = L(0,1) - p[2];
-  p[6] = L(2,0);
-  p[7] = L(2,1);
-  */
-
-  ParameterVector p;
+  Homography::ParameterVector p;
   p[0] = L(0,2);
   p[1] = L(1,2);
   p[2] = -L(1,0);
@@ -63,6 +57,81 @@ auto Homography::MatrixToParams(const Transform& H) -> ParameterVector
   return p;
 }
 
+/**
+ * \return the largest absolute row sum
+ */
+template <class Matrix> static inline
+typename Matrix::Scalar NormInf(const Matrix& A)
+{
+  return A.cwiseAbs().rowwise().sum().maxCoeff();
+}
+
+/**
+ * matrix exponential of the parameter updates.
+ *
+ * The updates of the tracker are small, for a norm up to 1/2 we evaluate the
+ * Taylor series in Horner form, with the fewest terms that reach float
+ * precision (4 to 5 terms for typical updates). Larger matrices are scaled to
+ * a norm of 1/2 and squared, which we do in double to keep the squarings
+ * accurate
+ */
+static inline auto Exp(const Homography::Transform& A) -> Homography::Transform
+{
+  typedef Homography::Transform Transform;
+
+  constexpr int MaxDegree = 16;
+  const double eps = 0.5 * std::numeric_limits<float>::epsilon();
+
+  const float a_norm = NormInf(A);
+  if(a_norm <= 0.5f)
+  {
+    // the truncation error is below a_norm^(k+1) / (k+1)!
+    int k = 1;
+    for(double r = a_norm * a_norm / 2; r > eps && k < MaxDegree; )
+      r *= a_norm / (++k + 1);
+
+    Transform E = Transform::Identity() + A / static_cast<float>(k);
+    for(int j = k - 1; j >= 1; --j)
+      E = Transform::Identity() + (A * E) / static_cast<float>(j);
+
+    return E;
+  }
+
+  const int n_squarings = static_cast<int>(std::ceil(std::log2(a_norm / 0.5f)));
+  const Eigen::Matrix3d B = A.cast<double>() * std::ldexp(1.0, -n_squarings);
+
+  Eigen::Matrix3d E = Eigen::Matrix3d::Identity() + B, term = B;
+  for(int k = 2; k <= MaxDegree; ++k)
+  {
+    term = (term * B) / static_cast<double>(k);
+    E += term;
+
+    // the remaining terms add up to less than the last one
+    if(NormInf(term) <= 1e-12)
+      break;
+  }
+
+  for(int i = 0; i < n_squarings; ++i)
+    E = E * E;
+
+  return E.cast<float>();
+}
+
+auto Homography::MatrixToParams(const Transform& H) -> ParameterVector
+{
+  return LogToParams(H.log());
+}
+
+auto Homography::ParamsNorm(const Transform& H) -> float
+{
+  //
+  // log(H) = H - I to first order, with H scaled to a unit determinant like
+  // the matrices from ParamsToMatrix
+  //
+  const Transform L = H / std::cbrt(H.determinant()) - Transform::Identity();
+  return LogToParams(L).norm();
+}
+
 auto Homography::ParamsToMatrix(const ParameterVector& p) -> Transform
 {
   Transform H;
@@ -71,7 +140,7 @@ auto Homography::ParamsToMatrix(const ParameterVector& p) -> Transform
       -p[2]        , p[3]/3 - p[4], p[1],
       p[6]         , p[7]         , -2*p[3]/3;
 
-  return H.exp();
+  return Exp(H);
 }
 
 auto Homography::Solve(const Hessian& A, const Gradient& b) -> ParameterVector
@@ -107,22 +176,5 @@ auto Homography::ComputeJacobian(float x, float y, float Ix, float Iy,
   return J;
 }
 
-auto Homography::ComputeWarpJacobian(float x, float y, float s, float c1, float c2)
-  -> WarpJacobian
-{
-  WarpJacobian Jw;
-  /*
-  Jw <<
-      1.0f/s, 0.0f, y - c2, x - c1, x - c1, y - c2, -s*sq(c1 - x), -s*(c1 - x)*(c2 - y),
-      0.0f, 1.0f/s, c1 - x, y - c2, c2 - y, 0.0f, -s*(c1 - x)*(c2 - y), -s*sq(c2 - y);
-      */
-
-  Jw <<
-      1/s,  0, y - c2, x - c1, x - c1, y - c2, -s*sq(c1 - x), -s*(c1 - x)*(c2 - y),
-      0,  1/s, c1 - x, y - c2, c2 - y,      0, -s*(c1 - x)*(c2 - y),  -s*sq(c2 - y);
-
-  return Jw;
-}
-
 } // bp
 
@@ -52,6 +52,13 @@ class Homography : public MotionModel<Homography>
    */
   static ParameterVector MatrixToParams(const Transform&);
 
+  /**
+   * \return the norm of the parameters of the matrix, for the convergence
+   * test. To first order in H - I, which avoids the matrix logarithm of
+   * MatrixToParams
+   */
+  static float ParamsNorm(const Transform&);
+
   /**
    * solve the linear system
    */
@@ -67,8 +74,8 @@ class Homography : public MotionModel<Homography>
     J = Homography::ComputeJacobian(x, y, Ix, Iy, s, c1, c2);
   }
 
-  static WarpJacobian ComputeWarpJacobian(float x, float y, float s = 1.0,
-                                          float c1 = 0.0, float c2 = 0.0);
+  static inline WarpJacobian ComputeWarpJacobian(float x, float y, float s = 1.0,
+                                                 float c1 = 0.0, float c2 = 0.0);
 
   static inline void ComputeWarpJacobian(Eigen::Ref<WarpJacobian> Jw, float x, float y,
                                          float s = 1.0f, float c1 = 0.0f, float c2 = 0.0f)
@@ -77,6 +84,19 @@ class Homography : public MotionModel<Homography>
   }
 }; // Homography
 
+inline auto Homography::ComputeWarpJacobian(float x, float y, float s, float c1, float c2)
+  -> WarpJacobian
+{
+  const float dx = x - c1, dy = y - c2;
+
+  WarpJacobian Jw;
+  Jw <<
+      1/s,  0, dy,  dx, dx, dy, -s*dx*dx, -s*dx*dy,
+      0,  1/s, -dx, dy, -dy, 0, -s*dx*dy, -s*dy*dy;
+
+  return Jw;
+}
+
 }; // bp
 
 #endif // BITPLANES_CORE_HOMOGRAPHY_H
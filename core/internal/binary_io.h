@@ -0,0 +1,144 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_INTERNAL_BINARY_IO_H
+#define BITPLANES_CORE_INTERNAL_BINARY_IO_H
+
+#include "bitplanes/utils/error.h"
+#include "bitplanes/utils/mapped_file.h"
+#include "bitplanes/utils/memory.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+namespace bp {
+
+/**
+ * Arrays in the binary files start at a multiple of this, so that they can be
+ * used in place from a mapped file
+ */
+static constexpr size_t BinaryAlignment = 64;
+
+/**
+ * Writes raw data to a file, padding the arrays to BinaryAlignment
+ */
+class BinaryWriter
+{
+ public:
+  explicit BinaryWriter(const std::string& filename)
+      : _os(filename, std::ios::binary), _offset(0)
+  {
+    THROW_ERROR_IF( !_os.is_open(), Format("failed to open '%s'", filename.c_str()).c_str() );
+  }
+
+  template <class T> inline void write(const T& v)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be POD");
+    writeBytes(&v, sizeof(T));
+  }
+
+  /**
+   * writes 'n' elements of T, aligned to BinaryAlignment
+   */
+  template <class T> inline void writeArray(const T* p, size_t n)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be POD");
+    align();
+    writeBytes(p, n * sizeof(T));
+  }
+
+  inline void align()
+  {
+    static const char zeros[BinaryAlignment] = {0};
+    const size_t r = _offset % BinaryAlignment;
+    if(r)
+      writeBytes(zeros, BinaryAlignment - r);
+  }
+
+  inline void close()
+  {
+    _os.close();
+    THROW_ERROR_IF( _os.fail(), "failed to write the file" );
+  }
+
+ private:
+  inline void writeBytes(const void* p, size_t n)
+  {
+    _os.write(reinterpret_cast<const char*>(p), n);
+    THROW_ERROR_IF( !_os, "failed to write the file" );
+    _offset += n;
+  }
+
+  std::ofstream _os;
+  size_t _offset;
+}; // BinaryWriter
+
+/**
+ * Reads the data written with BinaryWriter from a mapped file. The data is
+ * not parsed, reads return pointers into the mapping after a bounds check
+ */
+class BinaryReader
+{
+ public:
+  explicit BinaryReader(const SharedPointer<const MappedFile>& file)
+      : _file(file), _offset(0) {}
+
+  template <class T> inline T read()
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be POD");
+    T ret;
+    std::memcpy(&ret, readBytes(sizeof(T)), sizeof(T));
+    return ret;
+  }
+
+  /**
+   * \return a pointer to 'n' elements of T in the file
+   */
+  template <class T> inline const T* readArray(size_t n)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be POD");
+    align();
+    return reinterpret_cast<const T*>( readBytes(n * sizeof(T)) );
+  }
+
+  inline void align()
+  {
+    _offset = (_offset + BinaryAlignment - 1) & ~(BinaryAlignment - 1);
+  }
+
+  inline const SharedPointer<const MappedFile>& file() const { return _file; }
+
+ private:
+  inline const uint8_t* readBytes(size_t n)
+  {
+    THROW_ERROR_IF( _offset > _file->size() || n > _file->size() - _offset,
+                    "truncated file" );
+    const uint8_t* ret = _file->data() + _offset;
+    _offset += n;
+    return ret;
+  }
+
+  SharedPointer<const MappedFile> _file;
+  size_t _offset;
+}; // BinaryReader
+
+}; // bp
+
+#endif // BITPLANES_CORE_INTERNAL_BINARY_IO_H
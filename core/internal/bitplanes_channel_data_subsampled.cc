@@ -17,28 +17,187 @@
 
 #include "bitplanes/core/internal/bitplanes_channel_data_subsampled.h"
 #include "bitplanes/core/internal/ct.h"
+#include "bitplanes/core/internal/kernels.h"
+#include "bitplanes/core/internal/parallel.h"
+#include "bitplanes/core/internal/structure_tensor.h"
 #include "bitplanes/core/motion_model.h"
 #include "bitplanes/core/homography.h"
+#include "bitplanes/core/affine.h"
+#include "bitplanes/core/translation.h"
 #include "bitplanes/core/debug.h"
 #include "bitplanes/utils/error.h"
+#include "bitplanes/utils/utils.h"
 
 #include <opencv2/core.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
 #include <type_traits>
 
 namespace bp {
 
 
-static inline int GetNumValid(const cv::Rect& roi, int s)
+static inline int PopCount(unsigned x)
 {
-  int ret = 0;
-  for(int y = 1; y < roi.height-1; y += s)
-    for(int x = 1; x < roi.width-1; x += s)
-      ++ret;
+  return static_cast<int>( popcount(x) );
+}
+
+/**
+ * Warped rows of the input image around the template. We keep N rows in a
+ * ring buffer, a row 'r' lives at slot (r + N) % N. Rows shared between
+ * consecutive template rows are warped once. The buffer holds N*roi.width
+ * bytes and is owned by the caller
+ */
+template <int N = 3>
+class WarpedRowBuffer
+{
+ public:
+  WarpedRowBuffer(const cv::Mat& I, const Matrix33f& T, const cv::Rect& roi,
+                  simd::WarpRowKernel warp_row, uint8_t* buf)
+      : _I(I), _T(T), _roi(roi), _warp_row(warp_row)
+  {
+    for(int k = 0; k < N; ++k) {
+      _rows[k] = buf + k*roi.width;
+      _row_id[k] = -N - 1;
+    }
+  }
+
+  /**
+   * \return true if the row 'r' is already warped
+   */
+  inline bool has(int r) const { return _row_id[(r + N) % N] == r; }
 
-  return ret;
+  /**
+   * \return the warped row 'r', relative to the template roi. Rows down to -N
+   * are valid
+   */
+  inline const uint8_t* operator()(int r)
+  {
+    const int k = (r + N) % N;
+    if(_row_id[k] != r) {
+      _warp_row(_I, _T, _roi.x, r + _roi.y, _roi.width, 1, _rows[k]);
+      _row_id[k] = r;
+    }
+    return _rows[k];
+  }
+
+ private:
+  const cv::Mat& _I;
+  const Matrix33f& _T;
+  cv::Rect _roi;
+  simd::WarpRowKernel _warp_row;
+  uint8_t* _rows[N];
+  int _row_id[N];
+}; // WarpedRowBuffer
+
+/**
+ * census signature at column 'x' given the three rows around it
+ */
+static inline uint8_t CensusAt(const uint8_t* p0, const uint8_t* p,
+                               const uint8_t* p1, int x)
+{
+  const uint8_t v = p[x];
+  return ((p0[x-1] >= v) << 0) | ((p0[x  ] >= v) << 1) | ((p0[x+1] >= v) << 2) |
+         ((p [x-1] >= v) << 3) | ((p [x+1] >= v) << 4) |
+         ((p1[x-1] >= v) << 5) | ((p1[x  ] >= v) << 6) | ((p1[x+1] >= v) << 7);
+}
+
+/**
+ * census signature of 'n' pixels given their 3x3 neighborhoods stored as nine
+ * planes. The neighbor (dx, dy) of pixel i is q[(3*(dy+1) + dx+1)*n + i]
+ */
+static inline void CensusFromStencils(const uint8_t* q, int n, uint8_t* dst)
+{
+  const uint8_t* c = q + 4*n;
+  for(int i = 0; i < n; ++i)
+  {
+    const uint8_t v = c[i];
+    dst[i] = ((q[0*n+i] >= v) << 0) | ((q[1*n+i] >= v) << 1) |
+             ((q[2*n+i] >= v) << 2) | ((q[3*n+i] >= v) << 3) |
+             ((q[5*n+i] >= v) << 4) | ((q[6*n+i] >= v) << 5) |
+             ((q[7*n+i] >= v) << 6) | ((q[8*n+i] >= v) << 7);
+  }
+}
+
+/**
+ * \return the number of bytes forEachWarpedRow needs for a template of width
+ * 'w' and subsampling 's'
+ */
+static inline size_t WorkspaceSize(int w, int s)
+{
+  const int n_lattice = (w - 2) / s + 1;
+  return Arena::AlignedSize(3*w) +         // ring buffer rows
+         Arena::AlignedSize(2*w) +         // census rows
+         Arena::AlignedSize(s > 1 ? 10*n_lattice : 1); // stencils
+}
+
+/**
+ * \return the number of bytes linearizeESM needs per block of rows for a
+ * template of width 'w'
+ */
+static inline size_t ESMWorkspaceSize(int w)
+{
+  return Arena::AlignedSize(5*(w+2)) + // ring buffer rows, one column of margin
+         Arena::AlignedSize(3*w);      // census rows
+}
+
+/**
+ * gradient codes (see GradientCode) of the pixels c[0, n) of a census image
+ * with the given stride, stored as four planes of n bytes: gx_pos, gx_neg,
+ * gy_pos and gy_neg. The loop vectorizes over 16 or 32 pixels
+ */
+static inline void GradientCodesRow(const uint8_t* c, int stride, int n,
+                                    uint8_t* codes)
+{
+  uint8_t* gx_pos = codes;
+  uint8_t* gx_neg = codes + n;
+  uint8_t* gy_pos = codes + 2*n;
+  uint8_t* gy_neg = codes + 3*n;
+
+#pragma omp simd
+  for(int x = 0; x < n; ++x)
+  {
+    gx_pos[x] = c[x+1] & ~c[x-1];
+    gx_neg[x] = c[x-1] & ~c[x+1];
+    gy_pos[x] = c[x+stride] & ~c[x-stride];
+    gy_neg[x] = c[x-stride] & ~c[x+stride];
+  }
 }
 
+/**
+ * \return the eight bits of 'm' as floats, bit 'b' at index 'b'
+ */
+static inline Eigen::Map<const Eigen::Matrix<float, 8, 1>> ChannelBits(uint8_t m)
+{
+  struct Table
+  {
+    Table()
+    {
+      for(int m = 0; m < 256; ++m)
+        for(int b = 0; b < 8; ++b)
+          bits[m][b] = static_cast<float>((m >> b) & 1);
+    }
+
+    float bits[256][8];
+  }; // Table
+
+  static const Table table;
+  return Eigen::Map<const Eigen::Matrix<float, 8, 1>>(table.bits[m]);
+}
+
+/**
+ * set() collects the template pixels in tasks of this many lattice rows
+ */
+static constexpr int LatticeRowsPerTask = 16;
+
+/**
+ * Rows are linearized in blocks of about this many pixels. Smaller templates
+ * have a single block and are linearized in the calling thread
+ */
+static constexpr int RowBlockPixels = 8192;
+
 template <class M>
 void BitPlanesChannelDataSubSampled<M>::
 set(const cv::Mat& src, const cv::Rect& roi, float s, float c1, float c2)
@@ -49,121 +208,675 @@ set(const cv::Mat& src, const cv::Rect& roi, float s, float c1, float c2)
 
   THROW_ERROR_IF( s <= 0, "scale cannot be negative or 0" );
 
-  auto n_valid = GetNumValid(roi, _sub_sampling);
-  _pixels.resize(n_valid);
-  _jacobian.resize(8*n_valid, M::DOF);
+  THROW_ERROR_IF( roi.width > std::numeric_limits<uint16_t>::max(),
+                 "template is too wide" );
 
   cv::Mat C;
   simd::census(src, roi, C);
-  int stride = C.cols;
+  const int stride = C.cols;
 
-  /**
-   * compute the channel x- and y-gradient at col:=x for bit:=b
-   */
-  auto G = [=](const uint8_t* p, int x, int b)
+  auto StructureTensorOf = [](const GradientCode& gc)
   {
-    float ix1 = (p[x+1] & (1<<b)) >> b, ix2 = (p[x-1] & (1<<b)) >> b,
-          iy1 = (p[x+stride] & (1<<b)) >> b, iy2 = (p[x-stride] & (1<<b)) >> b;
-    return Eigen::Matrix<float,1,2>(0.5f*(ix1-ix2), 0.5f*(iy1-iy2));
-  }; //
-
-  typename M::WarpJacobian Jw;
-  auto* pixels_ptr = _pixels.data();
-  for(int y = 1, j = 0, i = 0; y < C.rows - 1; y += _sub_sampling)
+    return StructureTensor(gc.gx_pos, gc.gx_neg, gc.gy_pos, gc.gy_neg);
+  };
+
+  struct Candidate
   {
-    const auto* srow = C.ptr<const uint8_t>(y);
-    for(int x = 1; x < C.cols - 1; x += _sub_sampling, i+=8, ++j)
+    uint16_t x, y;
+    uint8_t c;
+    GradientCode gc;
+    float score;
+  }; // Candidate
+
+  //
+  // collect the pixels with a non-zero gradient in at least one channel. The
+  // gradient of a channel is 0.5*(b[x+1] - b[x-1]) which is positive when the
+  // bit is set only at x+1, and negative when set only at x-1 (same for y).
+  //
+  // The lattice rows y = 1 + k*s are independent. We count the candidates of
+  // every row, then the rows write their candidates at their offset in
+  // parallel, which keeps the raster order
+  //
+  const bool use_budget = _max_pixels > 0;
+  const int step = _sub_sampling;
+  const int n_lattice_rows = C.rows > 2 ? (C.rows - 3) / step + 1 : 0;
+  const int width = std::max(C.cols - 2, 0); // columns with a gradient
+  const int n_tasks = (n_lattice_rows + LatticeRowsPerTask - 1) / LatticeRowsPerTask;
+
+  auto is_candidate = [=](const uint8_t* codes, int x)
+  {
+    return 0 != (codes[x] | codes[width + x] | codes[2*width + x] | codes[3*width + x]);
+  };
+
+  std::vector<int> offsets(n_lattice_rows + 1, 0);
+  ParallelFor(n_tasks, [&](int t)
+  {
+    std::vector<uint8_t> codes(4*width);
+    const int k_end = std::min(n_lattice_rows, (t + 1) * LatticeRowsPerTask);
+    for(int k = t * LatticeRowsPerTask; k < k_end; ++k)
+    {
+      GradientCodesRow(C.ptr<const uint8_t>(1 + k*step) + 1, stride, width, codes.data());
+
+      int n = 0;
+      for(int x = 0; x < width; x += step)
+        n += is_candidate(codes.data(), x);
+      offsets[k + 1] = n;
+    }
+  });
+
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+  std::vector<Candidate> candidates(offsets.back());
+  ParallelFor(n_tasks, [&](int t)
+  {
+    std::vector<uint8_t> codes(4*width);
+    const int k_end = std::min(n_lattice_rows, (t + 1) * LatticeRowsPerTask);
+    for(int k = t * LatticeRowsPerTask; k < k_end; ++k)
+    {
+      const int y = 1 + k*step;
+      const auto* srow = C.ptr<const uint8_t>(y);
+      GradientCodesRow(srow + 1, stride, width, codes.data());
+
+      Candidate* dst = candidates.data() + offsets[k];
+      for(int x = 0; x < width; x += step)
+      {
+        if(!is_candidate(codes.data(), x))
+          continue;
+
+        const GradientCode gc = {codes[x], codes[width + x],
+                                 codes[2*width + x], codes[3*width + x]};
+
+        float score = 0.0f;
+        if(use_budget) {
+          // trace of the pixel's contribution to the Hessian
+          const auto Jw = M::ComputeWarpJacobian(x+1+roi.x, y+roi.y, s, c1, c2);
+          score = (Jw.transpose() * StructureTensorOf(gc) * Jw).trace();
+        }
+
+        *dst++ = {static_cast<uint16_t>(x+1), static_cast<uint16_t>(y),
+                  srow[x+1], gc, score};
+      }
+    }
+  });
+
+  if(use_budget && static_cast<int>(candidates.size()) > _max_pixels) {
+    std::nth_element(candidates.begin(), candidates.begin() + _max_pixels,
+                     candidates.end(), [](const Candidate& a, const Candidate& b) {
+                       return a.score > b.score; });
+    candidates.resize(_max_pixels);
+
+    // restore the raster order for memory locality during warping
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) {
+                return a.y < b.y || (a.y == b.y && a.x < b.x); });
+  }
+
+  const int n_valid = static_cast<int>(candidates.size());
+  _mapped.reset();
+  _mapped_jacobian = nullptr;
+  _pixels.resize(n_valid);
+  _xs.resize(n_valid);
+  _rows.clear();
+  _census_only = false;
+  if(_compact) {
+    _jacobian.resize(0, M::DOF);
+    _grad_mask.resize(0);
+    _grad_codes.resize(n_valid);
+  } else {
+    _jacobian.resize(8*n_valid, M::DOF);
+    _grad_mask.resize(n_valid);
+    _grad_codes.clear();
+  }
+
+  for(int j = 0; j < n_valid; ++j)
+  {
+    if(_rows.empty() || _rows.back().y != candidates[j].y)
+      _rows.push_back({candidates[j].y, j, j});
+    ++_rows.back().end;
+  }
+
+  _roi_stride = roi.width;
+  _roi = roi;
+  _s = s; _c1 = c1; _c2 = c2;
+
+  setRowBlocks();
+  _workspace.reset();
+  _workspace.reserve( workspaceSize() );
+
+  //
+  // the blocks of rows fill the per-pixel data and sum their part of the
+  // Hessian in parallel. The Hessian blocks are combined in a fixed order.
+  //
+  // The Hessian is accumulated per pixel as Jw^T * S * Jw, where S is the 2x2
+  // structure tensor of the channel gradients, rather than from the 8 rows of
+  // the Jacobian of every pixel. This works without the Jacobian matrix
+  //
+  const int n_blocks = static_cast<int>(_row_blocks.size()) - 1;
+  std::vector<Hessian, Eigen::aligned_allocator<Hessian>> hessians(n_blocks);
+  ParallelFor(n_blocks, [&](int b)
+  {
+    Hessian& H = hessians[b];
+    H.setZero();
+
+    const int row_begin = _row_blocks[b], row_end = _row_blocks[b+1];
+    if(row_begin == row_end)
+      return;
+
+    const int j_begin = _rows[row_begin].begin, j_end = _rows[row_end-1].end;
+    for(int j = j_begin; j < j_end; ++j)
     {
-      Jw = M::ComputeWarpJacobian(x+roi.x, y+roi.y, s, c1, c2);
-      //*pixels_ptr++ = srow[x];
-      pixels_ptr[j] = srow[x];
-      _jacobian.row(i+0) = G(srow, x, 0) * Jw;
-      _jacobian.row(i+1) = G(srow, x, 1) * Jw;
-      _jacobian.row(i+2) = G(srow, x, 2) * Jw;
-      _jacobian.row(i+3) = G(srow, x, 3) * Jw;
-      _jacobian.row(i+4) = G(srow, x, 4) * Jw;
-      _jacobian.row(i+5) = G(srow, x, 5) * Jw;
-      _jacobian.row(i+6) = G(srow, x, 6) * Jw;
-      _jacobian.row(i+7) = G(srow, x, 7) * Jw;
+      const auto& p = candidates[j];
+      _pixels[j] = p.c;
+      _xs[j] = p.x;
+
+      const auto Jw = M::ComputeWarpJacobian(p.x+roi.x, p.y+roi.y, s, c1, c2);
+      AddPixelHessian(StructureTensorOf(p.gc), Jw, H);
+
+      if(_compact) {
+        _grad_codes[j] = p.gc;
+        continue;
+      }
+
+      _grad_mask[j] = p.gc.gx_pos | p.gc.gx_neg | p.gc.gy_pos | p.gc.gy_neg;
+
+      // the 8x2 channel gradients, one row per channel
+      Eigen::Matrix<float, 8, 2> G;
+      G.col(0) = 0.5f * (ChannelBits(p.gc.gx_pos) - ChannelBits(p.gc.gx_neg));
+      G.col(1) = 0.5f * (ChannelBits(p.gc.gy_pos) - ChannelBits(p.gc.gy_neg));
+      _jacobian.template middleRows<8>(8*j).noalias() = G * Jw;
+    }
+  });
+
+  PairwiseReduce(n_blocks, [&](int b, int other) { hessians[b] += hessians[other]; });
+  _hessian = hessians[0];
+}
+
+template <class M>
+void BitPlanesChannelDataSubSampled<M>::
+setCensus(const cv::Mat& src, const cv::Rect& roi, float s, float c1, float c2)
+{
+  THROW_ERROR_IF(roi.x < 1 || roi.x > src.cols - 1 ||
+                 roi.y < 1 || roi.y > src.rows - 1,
+                 "template bounding box is outside image");
+
+  THROW_ERROR_IF( s <= 0, "scale cannot be negative or 0" );
+
+  THROW_ERROR_IF( roi.width > std::numeric_limits<uint16_t>::max(),
+                 "template is too wide" );
+
+  cv::Mat C;
+  simd::census(src, roi, C);
+
+  //
+  // every pixel of the lattice is kept, the ones with a zero gradient in the
+  // template may still have a gradient in the warped image
+  //
+  const int step = _sub_sampling;
+  const int n_lattice_rows = C.rows > 2 ? (C.rows - 3) / step + 1 : 0;
+  const int n_lattice_cols = C.cols > 2 ? (C.cols - 3) / step + 1 : 0;
+  const int n_valid = n_lattice_rows * n_lattice_cols;
+
+  _mapped.reset();
+  _mapped_jacobian = nullptr;
+  _compact = true;
+  _census_only = true;
+  _jacobian.resize(0, M::DOF);
+  _grad_mask.resize(0);
+  _grad_codes.clear();
+  _hessian.setZero();
+  _pixels.resize(n_valid);
+  _xs.resize(n_valid);
+  _rows.resize(n_lattice_cols ? n_lattice_rows : 0);
+
+  for(int k = 0, j = 0; k < static_cast<int>(_rows.size()); ++k)
+  {
+    const int y = 1 + k*step;
+    const auto* srow = C.ptr<const uint8_t>(y);
+    _rows[k] = {y, j, j + n_lattice_cols};
+    for(int x = 1; j < _rows[k].end; x += step, ++j) {
+      _pixels[j] = srow[x];
+      _xs[j] = static_cast<uint16_t>(x);
     }
   }
 
-  _hessian = _jacobian.transpose() * _jacobian;
   _roi_stride = roi.width;
+  _roi = roi;
+  _s = s; _c1 = c1; _c2 = c2;
+
+  setRowBlocks();
+  _workspace.reset();
+  _workspace.reserve( workspaceSize() );
+}
+
+template <class M>
+template <class Func>
+void BitPlanesChannelDataSubSampled<M>::
+forEachWarpedRow(const cv::Mat& I, const Transform& T, int row_begin, int row_end,
+                 uint8_t* scratch, Func&& f) const
+{
+  const auto& kernels = simd::GetKernels();
+
+  //
+  // the scratch memory is laid out as in WorkspaceSize()
+  //
+  WarpedRowBuffer<> rows(I, T, _roi, kernels.warp_row, scratch);
+  scratch += Arena::AlignedSize(3*_roi.width);
+  uint8_t* census_row = scratch; // full row
+  uint8_t* w = census_row + _roi.width; // census of the row's template pixels
+  scratch += Arena::AlignedSize(2*_roi.width);
+  uint8_t patch[9];
+
+  //
+  // template pixels lie on the lattice x = 1 + k*s. The stencil buffer holds
+  // the nine planes of the 3x3 neighborhoods of the lattice, plus their census
+  //
+  const int s = _sub_sampling;
+  uint8_t* stencils = scratch;
+
+  // a patch pixel is warped three at a time, without SIMD
+  constexpr int PatchCost = 4;
+
+  for(int i = row_begin; i < row_end; ++i)
+  {
+    const auto& r = _rows[i];
+    const int y = r.y, n = r.end - r.begin;
+    const uint16_t* xs = _xs.data() + r.begin;
+    const int k0 = (xs[0] - 1) / s, n_k = (xs[n-1] - 1) / s - k0 + 1;
+
+    //
+    // the number of pixels we warp to get the census of the row is
+    //  - rows:     'width' per row that is not already in the buffer
+    //  - stencils: the 3x3 neighborhoods of the lattice between the first and
+    //              last pixel, warped with a stride 's'. For s > 3 the
+    //              neighborhoods do not cover the rows and this is less work
+    //  - patches:  the 3x3 neighborhood of each pixel, useful if the row has
+    //              only a few pixels left after pruning
+    //
+    const int n_missing = !rows.has(y-1) + !rows.has(y) + !rows.has(y+1);
+    const int row_cost = n_missing*_roi.width,
+          stencil_cost = s > 1 ? 9*n_k : std::numeric_limits<int>::max(),
+          patch_cost = PatchCost*9*n;
+
+    if(patch_cost < row_cost && patch_cost < stencil_cost)
+    {
+      for(int j = 0; j < n; ++j)
+      {
+        const int x0 = _roi.x + xs[j] - 1;
+        kernels.warp_row(I, T, x0, _roi.y + y - 1, 3, 1, patch + 0);
+        kernels.warp_row(I, T, x0, _roi.y + y    , 3, 1, patch + 3);
+        kernels.warp_row(I, T, x0, _roi.y + y + 1, 3, 1, patch + 6);
+        w[j] = CensusAt(patch, patch + 3, patch + 6, 1);
+      }
+    }
+    else if(stencil_cost < row_cost)
+    {
+      const int x0 = _roi.x + 1 + k0*s;
+      for(int dy = -1; dy <= 1; ++dy)
+        for(int dx = -1; dx <= 1; ++dx)
+          kernels.warp_row(I, T, x0 + dx, _roi.y + y + dy, n_k, s,
+                           stencils + (3*(dy+1) + dx+1)*n_k);
+
+      uint8_t* c = stencils + 9*n_k;
+      CensusFromStencils(stencils, n_k, c);
+      for(int j = 0; j < n; ++j)
+        w[j] = c[(xs[j] - 1) / s - k0];
+    }
+    else
+    {
+      const uint8_t* p0 = rows(y - 1);
+      const uint8_t* p  = rows(y    );
+      const uint8_t* p1 = rows(y + 1);
+
+      // census of the interior of the row, census_row[x-1] is at column x
+      const int x_min = xs[0], x_max = xs[n-1];
+      kernels.census_row(p0 + x_min, p + x_min, p1 + x_min, x_max - x_min + 1,
+                         census_row);
+      for(int j = 0; j < n; ++j)
+        w[j] = census_row[xs[j] - x_min];
+    }
+
+    f(r, static_cast<const uint8_t*>(w));
+  }
+}
+
+template <class M>
+template <class Func>
+float BitPlanesChannelDataSubSampled<M>::
+reduceWarpedRows(const cv::Mat& I, const Transform& T, Gradient& g,
+                 Arena& workspace, Func&& f) const
+{
+  //
+  // the scratch memory comes from the workspace, see workspaceSize()
+  //
+  workspace.reset();
+
+  const int n_blocks = static_cast<int>(_row_blocks.size()) - 1;
+  const size_t block_bytes = WorkspaceSize(_roi.width, _sub_sampling);
+  uint8_t* scratch = workspace.allocate<uint8_t>(n_blocks * block_bytes);
+  float* g_blocks = workspace.allocate<float>(n_blocks * M::DOF);
+  int* sum_sq_blocks = workspace.allocate<int>(n_blocks);
+
+  auto linearize_block = [&](int b)
+  {
+    float* g_b = g_blocks + b*M::DOF;
+    std::fill_n(g_b, M::DOF, 0.0f);
+
+    int sum_sq = 0;
+    forEachWarpedRow(I, T, _row_blocks[b], _row_blocks[b+1], scratch + b*block_bytes,
+                     [&](const PixelRow& r, const uint8_t* w) { sum_sq += f(r, w, g_b); });
+    sum_sq_blocks[b] = sum_sq;
+  };
+
+  ParallelFor(n_blocks, linearize_block);
+
+  //
+  // the float sums depend on the order of the additions, see PairwiseReduce
+  //
+  PairwiseReduce(n_blocks, [&](int b, int other)
+  {
+    for(int k = 0; k < M::DOF; ++k)
+      g_blocks[b*M::DOF + k] += g_blocks[other*M::DOF + k];
+    sum_sq_blocks[b] += sum_sq_blocks[other];
+  });
+
+  g = Eigen::Map<const Gradient>(g_blocks);
+  return static_cast<float>( sum_sq_blocks[0] );
 }
 
 template <class M>
 void BitPlanesChannelDataSubSampled<M>::
 computeResiduals(const cv::Mat& Iw, Residuals& residuals) const
 {
-  //simd::census_residual_packed(Iw, _pixels, residuals, _sub_sampling, _roi_stride);
-  typedef int8_t CType;
-  cv::AutoBuffer<CType> buf(8*_pixels.size());
-  CType* r_ptr = buf;
+  residuals.resize(8*_pixels.size());
 
-  const uint8_t* c0_ptr = _pixels.data();
   const int src_stride = Iw.cols;
-  for(int y = 1; y < Iw.rows - 1; y += _sub_sampling)
+  for(const auto& r : _rows)
   {
-    const uint8_t* srow = Iw.ptr<const uint8_t>(y);
-
-#pragma omp simd
-    for(int x = 1; x < Iw.cols - 1; x += _sub_sampling)
+    const uint8_t* p = Iw.ptr<const uint8_t>(r.y);
+    for(int j = r.begin; j < r.end; ++j)
     {
-      const uint8_t* p = srow + x;
-      const uint8_t c = *c0_ptr++;
-      *r_ptr++ = (*(p - src_stride - 1) >= *p) - ((c & (1<<0)) >> 0);
-      *r_ptr++ = (*(p - src_stride    ) >= *p) - ((c & (1<<1)) >> 1);
-      *r_ptr++ = (*(p - src_stride + 1) >= *p) - ((c & (1<<2)) >> 2);
-      *r_ptr++ = (*(p              - 1) >= *p) - ((c & (1<<3)) >> 3);
-      *r_ptr++ = (*(p              + 1) >= *p) - ((c & (1<<4)) >> 4);
-      *r_ptr++ = (*(p + src_stride - 1) >= *p) - ((c & (1<<5)) >> 5);
-      *r_ptr++ = (*(p + src_stride    ) >= *p) - ((c & (1<<6)) >> 6);
-      *r_ptr++ = (*(p + src_stride + 1) >= *p) - ((c & (1<<7)) >> 7);
+      const uint8_t w = CensusAt(p - src_stride, p, p + src_stride, _xs[j]);
+      const uint8_t c = _pixels[j];
+      for(int b = 0; b < 8; ++b)
+        residuals[8*j + b] = static_cast<float>( ((w >> b) & 1) - ((c >> b) & 1) );
     }
   }
+}
 
-  using namespace Eigen;
-  residuals=Map<Vector_<CType>, Aligned>(buf,_pixels.size()*8,1).template cast<float>();
+template <class M>
+float BitPlanesChannelDataSubSampled<M>::
+linearize(const cv::Mat& I, const Transform& T, Gradient& g) const
+{
+  return linearize(I, T, g, _workspace);
 }
 
 template <class M>
 float BitPlanesChannelDataSubSampled<M>::
-doLinearize(const cv::Mat& Iw, Gradient& g) const
+linearize(const cv::Mat& I, const Transform& T, Gradient& g, Arena& workspace) const
 {
-  g.setZero();
-  float ret = 0.0f;
+  THROW_ERROR_IF( I.type() != CV_8UC1, "image must be CV_8UC1" );
+  THROW_ERROR_IF( _census_only, "the template has no gradients, see setCensus" );
 
-  const uint8_t* c0_ptr = _pixels.data();
-  const int src_stride = Iw.cols;
+  return _compact ? linearizeCompact(I, T, g, workspace) :
+      linearizeDense(I, T, g, workspace);
+}
 
-  for(int y = 1, i = 0; y < Iw.rows - 1; y += _sub_sampling)
+template <class M>
+size_t BitPlanesChannelDataSubSampled<M>::workspaceSize() const
+{
+  // scratch rows, gradient and sum of squares of every block
+  const size_t n_blocks = _row_blocks.size() - 1;
+  const size_t ret =
+      Arena::AlignedSize(n_blocks * WorkspaceSize(_roi.width, _sub_sampling)) +
+      Arena::AlignedSize(n_blocks * M::DOF * sizeof(float)) +
+      Arena::AlignedSize(n_blocks * sizeof(int));
+
+  if(!_compact)
+    return ret;
+
+  // compact templates can also be linearized with ESM or FC, which sum a
+  // Hessian too
+  return std::max(ret,
+      Arena::AlignedSize(n_blocks * ESMWorkspaceSize(_roi.width)) +
+      Arena::AlignedSize(n_blocks * M::DOF * sizeof(float)) +
+      Arena::AlignedSize(n_blocks * M::DOF * M::DOF * sizeof(float)) +
+      Arena::AlignedSize(n_blocks * sizeof(int)));
+}
+
+template <class M>
+void BitPlanesChannelDataSubSampled<M>::setRowBlocks()
+{
+  _row_blocks.assign(1, 0);
+
+  const int n_rows = static_cast<int>(_rows.size());
+  int n_pixels = 0;
+  for(int i = 0; i < n_rows - 1; ++i)
   {
-    const auto srow = Iw.ptr<const uint8_t>(y);
-    for(int x = 1; x < Iw.cols - 1; x += _sub_sampling, i += 8)
-    {
-      const auto* p = srow + x;
-      const auto* p0 = p - src_stride;
-      const auto* p1 = p + src_stride;
-
-      const auto c = *c0_ptr++;
-
-      Eigen::Matrix<float,8,1> err;
-      err[0] = (p0[-1] > *p) - ((c & (1<<0)) >> 0);
-      err[1] = (p0[ 0] > *p) - ((c & (1<<1)) >> 1);
-      err[2] = (p0[ 1] > *p) - ((c & (1<<2)) >> 2);
-      err[3] = (p [-1] > *p) - ((c & (1<<3)) >> 3);
-      err[4] = (p [ 0] > *p) - ((c & (1<<4)) >> 4);
-      err[5] = (p1[-1] > *p) - ((c & (1<<5)) >> 5);
-      err[6] = (p1[ 0] > *p) - ((c & (1<<6)) >> 6);
-      err[7] = (p1[ 1] > *p) - ((c & (1<<7)) >> 7);
-
-      g.noalias() += _jacobian.template block<8,8>(i, 0) * err;
-      ret += err.squaredNorm();
+    n_pixels += _rows[i].end - _rows[i].begin;
+    if(n_pixels >= RowBlockPixels) {
+      _row_blocks.push_back(i + 1);
+      n_pixels = 0;
     }
   }
 
-  return ret;
+  _row_blocks.push_back(n_rows);
+}
+
+template <class M>
+float BitPlanesChannelDataSubSampled<M>::
+linearizeDense(const cv::Mat& I, const Transform& T, Gradient& g,
+               Arena& workspace) const
+{
+  //
+  // residuals are in {-1, 0, 1}. Only the channels that differ between the
+  // warped and the template census contribute to the sum of squares, and only
+  // those with a non-zero Jacobian row contribute to the gradient. Hence, we
+  // add/subtract the Jacobian rows of these channels only
+  //
+  const auto accumulate = simd::GetKernels().accumulate;
+  return reduceWarpedRows(I, T, g, workspace,
+                          [&](const PixelRow& r, const uint8_t* w, float* g_b)
+  {
+    return accumulate(jacobianData() + 8*M::DOF*r.begin, M::DOF, w,
+                      _pixels.data() + r.begin, _grad_mask.data() + r.begin,
+                      r.end - r.begin, g_b);
+  });
+}
+
+template <class M>
+float BitPlanesChannelDataSubSampled<M>::
+linearizeCompact(const cv::Mat& I, const Transform& T, Gradient& g,
+                 Arena& workspace) const
+{
+  return reduceWarpedRows(I, T, g, workspace,
+                          [&](const PixelRow& r, const uint8_t* w_row, float* g_b)
+  {
+    Eigen::Map<Gradient> g_row(g_b);
+    int sum_sq = 0;
+    for(int j = r.begin; j < r.end; ++j)
+    {
+      const uint8_t c = _pixels[j], w = w_row[j - r.begin];
+      if(w == c)
+        continue;
+
+      sum_sq += PopCount(w ^ c);
+
+      // channels with a residual of +1 and -1
+      const GradientCode& gc = _grad_codes[j];
+      const unsigned r_pos = w & ~c, r_neg = c & ~w;
+
+      // sum of residual * channel gradient (in units of 0.5)
+      const int ex = PopCount((r_pos & gc.gx_pos) | (r_neg & gc.gx_neg)) -
+                     PopCount((r_pos & gc.gx_neg) | (r_neg & gc.gx_pos));
+      const int ey = PopCount((r_pos & gc.gy_pos) | (r_neg & gc.gy_neg)) -
+                     PopCount((r_pos & gc.gy_neg) | (r_neg & gc.gy_pos));
+      if(!(ex | ey))
+        continue;
+
+      const auto Jw = M::ComputeWarpJacobian(_xs[j] + _roi.x, r.y + _roi.y, _s, _c1, _c2);
+      g_row.noalias() += Jw.transpose() * Eigen::Vector2f(0.5f*ex, 0.5f*ey);
+    }
+
+    return sum_sq;
+  });
+}
+
+template <class M>
+float BitPlanesChannelDataSubSampled<M>::
+linearizeESM(const cv::Mat& I, const Transform& T, Gradient& g, Hessian& H,
+             Arena& workspace) const
+{
+  THROW_ERROR_IF( !_compact || _census_only,
+                  "ESM needs a template with compact storage" );
+  return linearizeImageGradients<true>(I, T, g, H, workspace);
+}
+
+template <class M>
+float BitPlanesChannelDataSubSampled<M>::
+linearizeFC(const cv::Mat& I, const Transform& T, Gradient& g, Hessian& H,
+            Arena& workspace) const
+{
+  THROW_ERROR_IF( !_compact, "FC needs a template with compact or census storage" );
+  return linearizeImageGradients<false>(I, T, g, H, workspace);
+}
+
+template <class M>
+template <bool ESM>
+float BitPlanesChannelDataSubSampled<M>::
+linearizeImageGradients(const cv::Mat& I, const Transform& T, Gradient& g,
+                        Hessian& H, Arena& workspace) const
+{
+  THROW_ERROR_IF( I.type() != CV_8UC1, "image must be CV_8UC1" );
+
+  //
+  // the scratch memory comes from the workspace, see workspaceSize()
+  //
+  workspace.reset();
+
+  const int n_blocks = static_cast<int>(_row_blocks.size()) - 1;
+  const size_t block_bytes = ESMWorkspaceSize(_roi.width);
+  uint8_t* scratch = workspace.allocate<uint8_t>(n_blocks * block_bytes);
+  float* g_blocks = workspace.allocate<float>(n_blocks * M::DOF);
+  float* H_blocks = workspace.allocate<float>(n_blocks * M::DOF * M::DOF);
+  int* sum_sq_blocks = workspace.allocate<int>(n_blocks);
+
+  const auto& kernels = simd::GetKernels();
+
+  //
+  // the census gradient of the warped image at a pixel needs the census of its
+  // four neighbors, i.e. the warped rows y-2 to y+2 and one more column on
+  // each side. The column x of the template is x+1 in the warped rows
+  //
+  const cv::Rect roi_e(_roi.x - 1, _roi.y, _roi.width + 2, _roi.height);
+
+  //
+  // the channel gradient is 0.5*i (FC) or the average 0.25*(t + i) (ESM) with
+  // t, i in {-1, 0, 1} the template and the warped image gradients
+  //
+  constexpr float Scale = ESM ? 0.25f : 0.5f;
+
+  auto linearize_block = [&](int b)
+  {
+    Eigen::Map<Gradient> g_b(g_blocks + b*M::DOF);
+    Eigen::Map<Hessian> H_b(H_blocks + b*M::DOF*M::DOF);
+    g_b.setZero();
+    H_b.setZero();
+
+    uint8_t* buf = scratch + b*block_bytes;
+    WarpedRowBuffer<5> rows(I, T, roi_e, kernels.warp_row, buf);
+
+    // census of the rows y-1, y and y+1
+    uint8_t* census[3];
+    census[0] = buf + Arena::AlignedSize(5*roi_e.width);
+    census[1] = census[0] + _roi.width;
+    census[2] = census[1] + _roi.width;
+
+    int sum_sq = 0;
+    for(int i = _row_blocks[b]; i < _row_blocks[b+1]; ++i)
+    {
+      const auto& r = _rows[i];
+
+      // census of the columns [x_min-1, x_max+1], column x at x - x_min + 1
+      const int x_min = _xs[r.begin], x_max = _xs[r.end-1];
+      for(int k = 0; k < 3; ++k)
+        kernels.census_row(rows(r.y + k - 2) + x_min, rows(r.y + k - 1) + x_min,
+                           rows(r.y + k) + x_min, x_max - x_min + 3, census[k]);
+
+      for(int j = r.begin; j < r.end; ++j)
+      {
+        const int k = _xs[j] - x_min + 1;
+        const uint8_t c = _pixels[j], w = census[1][k];
+
+        // channel gradients of the warped image, as in GradientCodesRow
+        const uint8_t ix_pos = census[1][k+1] & ~census[1][k-1],
+                      ix_neg = census[1][k-1] & ~census[1][k+1],
+                      iy_pos = census[2][k] & ~census[0][k],
+                      iy_neg = census[0][k] & ~census[2][k];
+
+        //
+        // structure tensor of the channel gradients in units of Scale. With
+        // ESM, it is the sum of (t + i)^T * (t + i)
+        //
+        int sxx = PopCount(ix_pos | ix_neg), syy = PopCount(iy_pos | iy_neg),
+            sxy = ChannelDot(ix_pos, ix_neg, iy_pos, iy_neg);
+        if(ESM) {
+          const GradientCode& gc = _grad_codes[j];
+          sxx += PopCount(gc.gx_pos | gc.gx_neg) +
+                 2*ChannelDot(gc.gx_pos, gc.gx_neg, ix_pos, ix_neg);
+          syy += PopCount(gc.gy_pos | gc.gy_neg) +
+                 2*ChannelDot(gc.gy_pos, gc.gy_neg, iy_pos, iy_neg);
+          sxy += ChannelDot(gc.gx_pos, gc.gx_neg, gc.gy_pos, gc.gy_neg) +
+                 ChannelDot(gc.gx_pos, gc.gx_neg, iy_pos, iy_neg) +
+                 ChannelDot(ix_pos, ix_neg, gc.gy_pos, gc.gy_neg);
+        }
+
+        if(!(sxx | syy)) {
+          sum_sq += PopCount(w ^ c);
+          continue;
+        }
+
+        const auto Jw = M::ComputeWarpJacobian(_xs[j] + _roi.x, r.y + _roi.y, _s, _c1, _c2);
+        Eigen::Matrix2f S;
+        S << sxx, sxy, sxy, syy;
+        AddPixelHessian((Scale * Scale) * S, Jw, H_b);
+
+        if(w == c)
+          continue;
+
+        sum_sq += PopCount(w ^ c);
+
+        // channels with a residual of +1 and -1
+        const uint8_t r_pos = w & ~c, r_neg = c & ~w;
+        int ex = ChannelDot(r_pos, r_neg, ix_pos, ix_neg),
+            ey = ChannelDot(r_pos, r_neg, iy_pos, iy_neg);
+        if(ESM) {
+          const GradientCode& gc = _grad_codes[j];
+          ex += ChannelDot(r_pos, r_neg, gc.gx_pos, gc.gx_neg);
+          ey += ChannelDot(r_pos, r_neg, gc.gy_pos, gc.gy_neg);
+        }
+
+        if(ex | ey)
+          g_b.noalias() += Jw.transpose() * Eigen::Vector2f(Scale*ex, Scale*ey);
+      }
+    }
+
+    sum_sq_blocks[b] = sum_sq;
+  };
+
+  ParallelFor(n_blocks, linearize_block);
+
+  PairwiseReduce(n_blocks, [&](int b, int other)
+  {
+    for(int k = 0; k < M::DOF; ++k)
+      g_blocks[b*M::DOF + k] += g_blocks[other*M::DOF + k];
+    for(int k = 0; k < M::DOF*M::DOF; ++k)
+      H_blocks[b*M::DOF*M::DOF + k] += H_blocks[other*M::DOF*M::DOF + k];
+    sum_sq_blocks[b] += sum_sq_blocks[other];
+  });
+
+  g = Eigen::Map<const Gradient>(g_blocks);
+  H = Eigen::Map<const Hessian>(H_blocks);
+  return static_cast<float>( sum_sq_blocks[0] );
 }
 
 template <class Derived> static inline
@@ -184,73 +897,57 @@ void BitPlanesChannelDataSubSampled<M>::
 warpImage(const cv::Mat& src, const Transform& T, const cv::Rect& roi,
           cv::Mat& dst, int interp, float border)
 {
-#if 1
-  cv::Mat xmap(roi.size(), CV_32FC1);
-  cv::Mat ymap(roi.size(), CV_32FC1);
-
-  THROW_ERROR_IF( xmap.empty() || ymap.empty(), "Failed to allocate interp maps" );
+  dst.create(roi.size(), src.type());
 
-  using namespace Eigen;
-
-  const int x_s = roi.x, y_s = roi.y;
-  for(int y = 0; y < roi.height; ++y)
+  if(interp == cv::INTER_LINEAR && border == 0.0f && src.type() == CV_8UC1)
   {
-    auto* xm_ptr = xmap.ptr<float>(y);
-    auto* ym_ptr = ymap.ptr<float>(y);
-
-    int yy = y + y_s;
+    //
+    // sample the image directly with the fixed-point row kernel, which gives
+    // the same result as cv::remap without the coordinate maps
+    //
+    const auto warp_row = simd::GetKernels().warp_row;
+    const Matrix33f H = T;
+    for(int y = 0; y < roi.height; ++y)
+      warp_row(src, H, roi.x, y + roi.y, roi.width, 1, dst.ptr<uint8_t>(y));
 
-    for(int x = 0; x < roi.width; ++x)
-    {
-      const Vector3f pw = normHomog(T*Vector3f(x + x_s, yy, 1.0f));
-      xm_ptr[x] = pw[0];
-      ym_ptr[x] = pw[1];
-    }
+    return;
   }
 
-  cv::remap(src, dst, xmap, ymap, interp, cv::BORDER_CONSTANT, cv::Scalar(border));
-#else
-
-  cv::Mat map1(roi.size(), CV_16SC2);
-  cv::Mat map2(roi.size(), CV_16UC1);
+  //
+  // general case. The maps are kept between calls
+  //
+  _xmap.create(roi.size(), CV_32FC1);
+  _ymap.create(roi.size(), CV_32FC1);
 
-  THROW_ERROR_IF( map1.empty() || map2.empty(), "Failed to allocate interp maps" );
+  THROW_ERROR_IF( _xmap.empty() || _ymap.empty(), "Failed to allocate interp maps" );
 
   using namespace Eigen;
 
   const int x_s = roi.x, y_s = roi.y;
   for(int y = 0; y < roi.height; ++y)
   {
-    auto* dst1 = map1.ptr<short>(y);
-    auto* dst2 = map2.ptr<ushort>(y);
+    auto* xm_ptr = _xmap.ptr<float>(y);
+    auto* ym_ptr = _ymap.ptr<float>(y);
+
+    int yy = y + y_s;
 
     for(int x = 0; x < roi.width; ++x)
     {
-      const Vector3f pw = normHomog(T*Vector3f(x + x_s, y + y_s, 1.0f)) * cv::INTER_TAB_SIZE;
-      int ix = cv::saturate_cast<int>(pw.x());
-      int iy = cv::saturate_cast<int>(pw.y());
-      dst1[2*x + 0] = cv::saturate_cast<short>( ix >> cv::INTER_BITS );
-      dst1[2*x + 1] = cv::saturate_cast<short>( iy >> cv::INTER_BITS );
-      dst2[x] = (ushort) ((iy & (cv::INTER_TAB_SIZE-1))*cv::INTER_TAB_SIZE +
-                          (ix & (cv::INTER_TAB_SIZE-1)));
+      const Vector3f pw = normHomog(T*Vector3f(x + x_s, yy, 1.0f));
+      xm_ptr[x] = pw[0];
+      ym_ptr[x] = pw[1];
     }
   }
 
-  cv::remap(src, dst, map1, map2, interp, cv::BORDER_CONSTANT, cv::Scalar(border));
-
-#endif
+  cv::remap(src, dst, _xmap, _ymap, interp, cv::BORDER_CONSTANT, cv::Scalar(border));
 }
 
+//
+// the warp Jacobians of all the motion models are expressed in these
+// coordinates, see M::ComputeWarpJacobian(x, y, s, c1, c2)
+//
 template <class M>
 void BitPlanesChannelDataSubSampled<M>::
-getCoordinateNormalization(const cv::Rect& /*roi*/, Transform& T, Transform& T_inv) const
-{
-  T.setIdentity();
-  T_inv.setIdentity();
-}
-
-template <>
-void BitPlanesChannelDataSubSampled<Homography>::
 getCoordinateNormalization(const cv::Rect& roi, Transform& T, Transform& T_inv) const
 {
   Vector2f c(0,0);
@@ -278,6 +975,129 @@ getCoordinateNormalization(const cv::Rect& roi, Transform& T, Transform& T_inv)
            0, 0, 1;
 }
 
+namespace {
+
+/**
+ * The fixed-size part of the template data in the binary file
+ */
+struct ChannelDataHeader
+{
+  int32_t dof;
+  int32_t sub_sampling;
+  int32_t compact;
+  int32_t census_only;
+  int32_t max_pixels;
+  int32_t roi[4];
+  float s, c1, c2;
+  uint32_t n_pixels;
+  uint32_t n_rows;
+}; // ChannelDataHeader
+
+/**
+ * copies 'n' elements of T from the file to 'dst', which is resized to 'n'
+ * after the bounds check
+ */
+template <class T, class Container> static inline
+void ReadArray(BinaryReader& reader, size_t n, Container& dst)
+{
+  const T* src = reader.readArray<T>(n);
+  dst.resize(n);
+  if(n)
+    std::memcpy(dst.data(), src, n * sizeof(T));
+}
+
+} // namespace
+
+template <class M>
+void BitPlanesChannelDataSubSampled<M>::write(BinaryWriter& writer) const
+{
+  ChannelDataHeader h;
+  std::memset(&h, 0, sizeof(h));
+  h.dof = M::DOF;
+  h.sub_sampling = _sub_sampling;
+  h.compact = _compact;
+  h.census_only = _census_only;
+  h.max_pixels = _max_pixels;
+  h.roi[0] = _roi.x; h.roi[1] = _roi.y; h.roi[2] = _roi.width; h.roi[3] = _roi.height;
+  h.s = _s; h.c1 = _c1; h.c2 = _c2;
+  h.n_pixels = static_cast<uint32_t>(_pixels.size());
+  h.n_rows = static_cast<uint32_t>(_rows.size());
+  writer.write(h);
+
+  const size_t n = _pixels.size();
+  writer.writeArray(_hessian.data(), _hessian.size());
+  writer.writeArray(_rows.data(), _rows.size());
+  writer.writeArray(_xs.data(), n);
+  writer.writeArray(_pixels.data(), n);
+  if(!_compact) {
+    writer.writeArray(_grad_mask.data(), n);
+    writer.writeArray(jacobianData(), 8*n*M::DOF);
+  } else if(!_census_only) {
+    writer.writeArray(_grad_codes.data(), n);
+  }
+}
+
+template <class M>
+void BitPlanesChannelDataSubSampled<M>::read(BinaryReader& reader)
+{
+  const auto h = reader.read<ChannelDataHeader>();
+  THROW_ERROR_IF( h.dof != M::DOF, "the template has a different motion model" );
+  THROW_ERROR_IF( h.sub_sampling < 1 || h.roi[2] < 3 || h.roi[3] < 3,
+                  "invalid template data" );
+
+  _sub_sampling = h.sub_sampling;
+  _compact = h.compact != 0 || h.census_only != 0;
+  _census_only = h.census_only != 0;
+  _max_pixels = h.max_pixels;
+  _roi = cv::Rect(h.roi[0], h.roi[1], h.roi[2], h.roi[3]);
+  _roi_stride = _roi.width;
+  _s = h.s; _c1 = h.c1; _c2 = h.c2;
+
+  const size_t n = h.n_pixels;
+  std::memcpy(_hessian.data(), reader.readArray<float>(_hessian.size()),
+              _hessian.size() * sizeof(float));
+
+  ReadArray<PixelRow>(reader, h.n_rows, _rows);
+  ReadArray<uint16_t>(reader, n, _xs);
+
+  //
+  // linearize trusts the pixel coordinates, check that they are inside the
+  // template and sorted within the rows
+  //
+  for(const auto& r : _rows)
+  {
+    THROW_ERROR_IF( r.begin < 0 || r.begin >= r.end || static_cast<size_t>(r.end) > n ||
+                    r.y < 1 || r.y >= _roi.height - 1, "invalid template data" );
+    for(int j = r.begin; j < r.end; ++j)
+      THROW_ERROR_IF( _xs[j] < 1 || _xs[j] >= _roi.width - 1 ||
+                      (j > r.begin && _xs[j] <= _xs[j-1]), "invalid template data" );
+  }
+
+  ReadArray<uint8_t>(reader, n, _pixels);
+
+  _jacobian.resize(0, M::DOF);
+  if(_compact) {
+    if(_census_only)
+      _grad_codes.clear();
+    else
+      ReadArray<GradientCode>(reader, n, _grad_codes);
+    _grad_mask.resize(0);
+    _mapped.reset();
+    _mapped_jacobian = nullptr;
+  } else {
+    _grad_codes.clear();
+    ReadArray<uint8_t>(reader, n, _grad_mask);
+    _mapped_jacobian = reader.readArray<float>(8*n*M::DOF);
+    _mapped = reader.file();
+  }
+
+  setRowBlocks();
+  _workspace.reset();
+  _workspace.reserve( workspaceSize() );
+}
+
 template class BitPlanesChannelDataSubSampled<Homography>;
+template class BitPlanesChannelDataSubSampled<Affine>;
+template class BitPlanesChannelDataSubSampled<Translation>;
 }
 
@@ -20,9 +20,13 @@
 
 #include "bitplanes/core/internal/bitplanes_channel_data_base.h"
 #include "bitplanes/core/motion_model.h"
+#include "bitplanes/core/internal/binary_io.h"
+#include "bitplanes/utils/memory.h"
 
 #include <opencv2/imgproc.hpp>
 
+#include <vector>
+
 namespace bp {
 
 template <class> class BitPlanesChannelDataSubSampled;
@@ -42,37 +46,241 @@ class BitPlanesChannelDataSubSampled :
   typedef typename Base::Hessian Hessian;
   typedef typename Base::Transform Transform;
   typedef typename Base::Gradient Gradient;
+  typedef Eigen::Map<const JacobianMatrix> JacobianMap;
+
+  /**
+   * Gradient of the eight channels at a pixel. Each channel gradient component
+   * is one of {-0.5, 0, 0.5}, so it is stored as two bit masks (one bit per
+   * channel) for the positive and negative values
+   */
+  struct GradientCode
+  {
+    uint8_t gx_pos, gx_neg;
+    uint8_t gy_pos, gy_neg;
+  }; // GradientCode
+
+  typedef std::vector<GradientCode> GradientCodes;
+
+  /**
+   * A row of the template with informative pixels. The pixels of the row are
+   * [begin, end) in the per-pixel arrays
+   */
+  struct PixelRow
+  {
+    int y;          //< row relative to the roi
+    int begin, end; //< range of pixels
+  }; // PixelRow
 
  public:
   /**
    * \param s subsampling/decimation factor. A value of 1 means no decimation, a
    * value of 2 means decimate by half, and so on
+   *
+   * \param compact if true, the Jacobian matrix is not stored. Instead, we
+   * keep the gradient codes and recompute the warp Jacobian on the fly during
+   * linearization
+   *
+   * \param max_pixels maximum number of template pixels to use. If the
+   * template has more informative pixels, we keep the ones with the largest
+   * contribution to the Hessian. A value <= 0 means no limit
    */
-  inline BitPlanesChannelDataSubSampled(size_t s = 1)
-      : Base(), _sub_sampling(s) {}
+  inline BitPlanesChannelDataSubSampled(size_t s = 1, bool compact = false,
+                                        int max_pixels = -1)
+      : Base(), _row_blocks(2, 0), _sub_sampling(s), _compact(compact),
+        _max_pixels(max_pixels) {}
 
+  /**
+   * Sets the template. Only pixels with a non-zero channel gradient are kept,
+   * since the others do not contribute to the gradient or the Hessian.
+   *
+   * The scratch buffers used by linearize are also allocated here, so that
+   * linearize does not allocate
+   */
   void set(const cv::Mat&, const cv::Rect& roi, float s = 1,
            float c1 = 0, float c2 = 0);
 
+  /**
+   * Sets the template for the forward compositional linearization (see
+   * linearizeFC), which takes the channel gradients from the warped image.
+   * Only the census signatures of the lattice pixels are kept: there is no
+   * pixel selection (max_pixels is not used), Jacobian or Hessian, hence this
+   * is much cheaper than set()
+   */
+  void setCensus(const cv::Mat&, const cv::Rect& roi, float s = 1,
+                 float c1 = 0, float c2 = 0);
+
+  /**
+   * computes the residuals of the template pixels
+   *
+   * \param Iw the warped image (the size of the roi)
+   * \param residuals output residuals, 8 per template pixel
+   */
   void computeResiduals(const cv::Mat& Iw, Residuals& residuals) const;
 
-  float doLinearize(const cv::Mat& Iw, Gradient&) const;
+  /**
+   * Fused linearization. Warps the input image around the template pixels,
+   * computes the census residuals against the template and accumulates the
+   * gradient J^T * r without storing the warped image or the residuals
+   *
+   * \param I the input image (not warped)
+   * \param T the current transform
+   * \param g output gradient of the cost function
+   * \return sum of squared residuals
+   */
+  float linearize(const cv::Mat& I, const Transform& T, Gradient& g) const;
+
+  /**
+   * Same as above, with the scratch memory taken from 'workspace' instead of
+   * the internal buffers. Different threads may linearize the same template
+   * concurrently, each with its own workspace.
+   *
+   * Large templates are linearized in blocks of rows in parallel (TBB or
+   * OpenMP). The blocks depend only on the template and their sums are
+   * combined in a fixed order, hence the result does not depend on the number
+   * of threads
+   */
+  float linearize(const cv::Mat& I, const Transform& T, Gradient& g,
+                  Arena& workspace) const;
+
+  /**
+   * Efficient Second-order Minimization (ESM) linearization. The Jacobian of a
+   * channel is the average of the template and the warped image channel
+   * gradients, times the warp Jacobian. It changes with T, hence the Hessian
+   * J^T * J is summed with the gradient.
+   *
+   * The template gradients are taken from the gradient codes, hence the data
+   * must be compact
+   *
+   * \param H output Hessian at T
+   * \return sum of squared residuals
+   */
+  float linearizeESM(const cv::Mat& I, const Transform& T, Gradient& g,
+                     Hessian& H, Arena& workspace) const;
+
+  /**
+   * Forward compositional (FC) linearization. The Jacobian of a channel is the
+   * warped image channel gradient times the warp Jacobian, hence the template
+   * needs only the census signatures. The data must have the census storage
+   * (see setCensus) or the compact storage, not the dense Jacobian
+   *
+   * \param H output Hessian at T
+   * \return sum of squared residuals
+   */
+  float linearizeFC(const cv::Mat& I, const Transform& T, Gradient& g,
+                    Hessian& H, Arena& workspace) const;
+
+  /**
+   * \return the number of bytes the linearizations need from the workspace
+   */
+  size_t workspaceSize() const;
 
+  /**
+   * Warps the image in the roi. Bilinear interpolation with a zero border (the
+   * default) samples the image directly with the SIMD row kernels, the other
+   * modes go through cv::remap. 'dst' is reused if it has the right size
+   */
   void warpImage(const cv::Mat& src, const Transform& T, const cv::Rect& roi,
                  cv::Mat& dst, int interp = cv::INTER_LINEAR, float border = 0.0f);
 
   inline const Pixels& pixels() const { return _pixels; }
   inline const Hessian& hessian() const { return _hessian; }
-  inline const JacobianMatrix& jacobian() const { return _jacobian; }
+  /**
+   * \return the Jacobian matrix. This is empty if the data is compact
+   */
+  inline JacobianMap jacobian() const
+  {
+    return JacobianMap(jacobianData(), _compact ? 0 : 8*_pixels.size(), M::DOF);
+  }
+
+  inline const GradientCodes& gradientCodes() const { return _grad_codes; }
+  inline const std::vector<PixelRow>& pixelRows() const { return _rows; }
+  inline const std::vector<uint16_t>& pixelCols() const { return _xs; }
+  inline bool isCompact() const { return _compact; }
+  /**
+   * \return true if the template has only the census signatures (setCensus)
+   */
+  inline bool isCensusOnly() const { return _census_only; }
 
   void getCoordinateNormalization(const cv::Rect&, Transform&, Transform&) const;
 
+  /**
+   * Writes the template data to a binary file (see BinaryWriter)
+   */
+  void write(BinaryWriter&) const;
+
+  /**
+   * Reads the template data written by write(). The Jacobian matrix is used
+   * in place from the file, the other arrays are copied
+   */
+  void read(BinaryReader&);
+
+ protected:
+  inline const float* jacobianData() const
+  {
+    return _mapped_jacobian ? _mapped_jacobian : _jacobian.data();
+  }
+
+  /**
+   * calls f(row, c) for the rows [row_begin, row_end) of template pixels, where
+   * c[j - row.begin] is the census signature of the image warped with T at the
+   * pixel 'j'. 'scratch' is the scratch memory of one block of rows
+   */
+  template <class Func>
+  void forEachWarpedRow(const cv::Mat& I, const Transform& T, int row_begin,
+                        int row_end, uint8_t* scratch, Func&& f) const;
+
+  /**
+   * sums f(row, c, g_b) over the rows, where f adds the gradient of the row to
+   * g_b and returns its sum of squares. Blocks of rows are summed in parallel
+   * and combined pairwise in a fixed order
+   */
+  template <class Func>
+  float reduceWarpedRows(const cv::Mat& I, const Transform& T, Gradient& g,
+                         Arena& workspace, Func&& f) const;
+
+  /**
+   * splits the rows into blocks of about the same number of pixels
+   */
+  void setRowBlocks();
+
+  float linearizeDense(const cv::Mat& I, const Transform& T, Gradient& g,
+                       Arena& workspace) const;
+  float linearizeCompact(const cv::Mat& I, const Transform& T, Gradient& g,
+                         Arena& workspace) const;
+
+  /**
+   * ESM and FC linearization with the channel gradients of the warped image.
+   * With ESM they are averaged with the template gradients
+   */
+  template <bool ESM>
+  float linearizeImageGradients(const cv::Mat& I, const Transform& T, Gradient& g,
+                                Hessian& H, Arena& workspace) const;
+
  protected:
   JacobianMatrix _jacobian;
+  GradientCodes _grad_codes;
+  Pixels _grad_mask; //< channels with a non-zero Jacobian row (dense storage)
+  std::vector<PixelRow> _rows; //< rows with informative pixels
+  std::vector<int> _row_blocks; //< the rows of the linearization blocks
+  std::vector<uint16_t> _xs;   //< column of every pixel, relative to the roi
   Pixels _pixels;
   Hessian _hessian;
   int _sub_sampling;
   int _roi_stride;
+  cv::Rect _roi;
+  bool _compact;
+  bool _census_only = false; //< no gradients, see setCensus
+  int _max_pixels;
+  float _s, _c1, _c2; //< normalization used for the warp Jacobians
+  cv::Mat _xmap, _ymap; //< interpolation maps for warpImage
+  mutable Arena _workspace; //< scratch buffers of linearize(I, T, g), sized in set()
+
+  //
+  // the Jacobian matrix of a template read from a file is not copied. We keep
+  // a reference to the file so that the mapping outlives the data
+  //
+  SharedPointer<const MappedFile> _mapped;
+  const float* _mapped_jacobian = nullptr;
 }; // BitPlanesChannelDataSubSampled
 
 }; // bp
@@ -17,7 +17,10 @@
 
 #include "bitplanes/core/internal/bitplanes_sparse_data.h"
 #include "bitplanes/core/internal/census_signature.h"
+#include "bitplanes/core/internal/structure_tensor.h"
 #include "bitplanes/core/homography.h"
+#include "bitplanes/core/affine.h"
+#include "bitplanes/core/translation.h"
 #include "bitplanes/utils/error.h"
 
 #include <opencv2/core.hpp>
@@ -71,8 +74,15 @@ set(const cv::Mat& I, const cv::Rect& roi, float s, float c1, float c2) -> Hessi
   _jacobian.resize(8*n, MotionModelType::DOF);
   _pixels.resize(8*n);
 
-  //Hessian ret;
-  //ret.setZero();
+  //
+  // the Hessian is accumulated per point as Jw^T * S * Jw, where S is the 2x2
+  // structure tensor of the channel gradients, see AddPixelHessian. Partial
+  // sums over chunks of points keep the float rounding error small
+  //
+  constexpr size_t ChunkSize = 1024;
+  Hessian ret, H_chunk;
+  ret.setZero();
+  H_chunk.setZero();
   for(size_t i = 0; i < n; ++i)
   {
     int y = pts[i].pt.y, x = pts[i].pt.x;
@@ -95,14 +105,19 @@ set(const cv::Mat& I, const cv::Rect& roi, float s, float c1, float c2) -> Hessi
       _jacobian.row(8*i+b) = 0.5f * Eigen::Matrix<float,1,2>(
           (CensusBit<float>( cx1, b ) - CensusBit<float>( cx0, b ) ),
           (CensusBit<float>( cy1, b ) - CensusBit<float>( cy0, b ) ) ) * Jw;
+    }
+
+    const uint8_t gx_pos = cx1 & ~cx0, gx_neg = cx0 & ~cx1,
+                  gy_pos = cy1 & ~cy0, gy_neg = cy0 & ~cy1;
+    AddPixelHessian(StructureTensor(gx_pos, gx_neg, gy_pos, gy_neg), Jw, H_chunk);
 
-      //ret.noalias() += _jacobian.row(8*i+b).transpose() * _jacobian.row(8*i+b);
-      //ret.template selfadjointView<Eigen::Upper>().rankUpdate(_jacobian.row(8*i+b), 1.0f);
+    if((i + 1) % ChunkSize == 0 || i + 1 == n) {
+      ret += H_chunk;
+      H_chunk.setZero();
     }
   }
 
-  //return ret;
-  return _jacobian.transpose() * _jacobian;
+  return ret;
 }
 
 
@@ -159,6 +174,8 @@ linearize(const cv::Mat& I, const Matrix33f& T, Gradient& g) const
 }
 
 template class BitPlanesSparseData<Homography>;
+template class BitPlanesSparseData<Affine>;
+template class BitPlanesSparseData<Translation>;
 
 } // bp
 
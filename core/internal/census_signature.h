@@ -19,6 +19,8 @@
 #define BITPLANES_CORE_INTERNAL_CENSUS_SIGNATURE_H
 
 #include "bitplanes/core/internal/v128.h"
+#include "bitplanes/core/internal/v256.h"
+#include "bitplanes/core/internal/v512.h"
 
 namespace bp {
 
@@ -123,6 +125,37 @@ FORCE_INLINE v128 CensusSignatureSIMD(const uint8_t* p, int s)
       CensusBit<5>(p, c, s) | CensusBit<6>(p, c, s) | CensusBit<7>(p, c, s) ;
 }
 
+/**
+ * computes the signature of V::Size pixels at once. V is one of v128, v256 or
+ * v512
+ *
+ * \param r0 pointer to the row above the pixels
+ * \param r1 pointer to the pixels
+ * \param r2 pointer to the row below the pixels
+ */
+template <class V> FORCE_INLINE
+V CensusSignatureSIMD(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2)
+{
+  const V c(r1);
+  return
+      ((V(r0 - 1) >= c) & V(0x01)) | ((V(r0    ) >= c) & V(0x02)) |
+      ((V(r0 + 1) >= c) & V(0x04)) | ((V(r1 - 1) >= c) & V(0x08)) |
+      ((V(r1 + 1) >= c) & V(0x10)) | ((V(r2 - 1) >= c) & V(0x20)) |
+      ((V(r2    ) >= c) & V(0x40)) | ((V(r2 + 1) >= c) & V(0x80)) ;
+}
+
+/**
+ * computes the signature of V::Size pixels at once
+ *
+ * \param p pointer to the first pixel
+ * \param s image stride
+ */
+template <class V> FORCE_INLINE
+V CensusSignatureSIMD(const uint8_t* p, int s)
+{
+  return CensusSignatureSIMD<V>(p - s, p, p + s);
+}
+
 FORCE_INLINE void CensusSignature(const uint8_t* p, int s, uint8_t* dst)
 {
   v128 c = CensusSignatureSIMD(p, s);
@@ -16,6 +16,7 @@
 */
 
 #include "bitplanes/core/internal/ct.h"
+#include "bitplanes/core/internal/kernels.h"
 #include "bitplanes/core/config.h"
 #include "bitplanes/utils/utils.h"
 #include "bitplanes/utils/error.h"
@@ -55,34 +56,14 @@ void census(const cv::Mat& src, const cv::Rect& roi, cv::Mat& dst)
   dst.create(roi.size(), src.type());
   THROW_ERROR_IF( dst.empty(), "Failed to allocate memory" );
 
-  int src_stride = src.cols;
+  const int src_stride = src.cols;
+  const auto& kernels = GetKernels();
 
   for(int y = 0; y < roi.height; ++y)
   {
-    const uint8_t* srow = src.ptr<const uint8_t>(y + roi.y);
-    uint8_t* drow = dst.ptr<uint8_t>(y);
-
-    int x = 0;
-
-#if HAVE_SSE2
-#endif
-
-#if HAVE_NEON
-#endif
-
-    for( ; x < roi.width; ++x)
-    {
-      const uint8_t* p = srow + x + roi.x;
-      drow[x] =
-          ((*(p - src_stride - 1) >= *p) << 0) |
-          ((*(p - src_stride    ) >= *p) << 1) |
-          ((*(p - src_stride + 1) >= *p) << 2) |
-          ((*(p              - 1) >= *p) << 3) |
-          ((*(p              + 1) >= *p) << 4) |
-          ((*(p + src_stride - 1) >= *p) << 5) |
-          ((*(p + src_stride    ) >= *p) << 6) |
-          ((*(p + src_stride + 1) >= *p) << 7) ;
-    }
+    const uint8_t* p = src.ptr<const uint8_t>(y + roi.y) + roi.x;
+    kernels.census_row(p - src_stride, p, p + src_stride, roi.width,
+                       dst.ptr<uint8_t>(y));
   }
 }
 
@@ -0,0 +1,280 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitplanes/core/internal/image_pyramid.h"
+#include "bitplanes/core/internal/kernels.h"
+#include "bitplanes/utils/error.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace bp {
+
+static inline cv::Size LevelSize(const cv::Size& s)
+{
+  return cv::Size((s.width + 1) / 2, (s.height + 1) / 2);
+}
+
+ImagePyramid::Filter ImagePyramid::MakeFilter(float sigma)
+{
+  std::vector<float> h = {1/16.f, 4/16.f, 6/16.f, 4/16.f, 1/16.f};
+
+  if(sigma > 0.0f)
+  {
+    //
+    // the Gaussian at level 'i' has std. deviation 2*sigma at level i-1
+    //
+    const int r = std::max(1, static_cast<int>(std::ceil(3.0f * 2.0f*sigma)));
+    const cv::Mat g = cv::getGaussianKernel(2*r + 1, 2.0f*sigma, CV_32F);
+
+    std::vector<float> hg(h.size() + 2*r, 0.0f);
+    for(size_t k = 0; k < h.size(); ++k)
+      for(int j = 0; j <= 2*r; ++j)
+        hg[k + j] += h[k] * g.at<float>(j);
+    h.swap(hg);
+  }
+
+  return ToFixedPoint(h);
+}
+
+ImagePyramid::Filter ImagePyramid::MakeGaussianFilter(float sigma)
+{
+  const int r = std::max(1, static_cast<int>(std::ceil(3.0f * sigma)));
+  const cv::Mat g = cv::getGaussianKernel(2*r + 1, sigma, CV_32F);
+
+  return ToFixedPoint(std::vector<float>(g.ptr<float>(), g.ptr<float>() + 2*r + 1));
+}
+
+ImagePyramid::Filter ImagePyramid::ToFixedPoint(const std::vector<float>& h)
+{
+  Filter ret;
+  ret.radius = static_cast<int>(h.size()) / 2;
+  ret.taps.assign(h.size() + (h.size() & 1), 0);
+
+  int sum = 0;
+  for(size_t k = 0; k < h.size(); ++k) {
+    ret.taps[k] = static_cast<int16_t>( std::lround(h[k] * (1 << simd::FilterBits)) );
+    sum += ret.taps[k];
+  }
+
+  // the rounding error goes to the center tap, so that the taps sum to one
+  ret.taps[ret.radius] += (1 << simd::FilterBits) - sum;
+  return ret;
+}
+
+void ImagePyramid::init(const cv::Size& size, const std::vector<float>& sigmas)
+{
+  THROW_ERROR_IF( sigmas.empty(), "pyramid must have at least one level" );
+
+  _sigmas = sigmas;
+  _size = size;
+  _levels.resize(sigmas.size());
+  _smoothed.resize(sigmas.size());
+
+  //
+  // a few regions per level, one for each template that uses the pyramid
+  //
+  _valid.assign(sigmas.size(), Regions());
+  _prepared.assign(sigmas.size(), Regions());
+  for(size_t i = 0; i < sigmas.size(); ++i) {
+    _valid[i].reserve(16);
+    _prepared[i].reserve(16);
+  }
+
+  _pyr_down = MakeFilter(0.0f);
+  _smooth_down.assign(sigmas.size(), Filter());
+  if(sigmas[0] > 0.0f)
+    _smooth_down[0] = MakeGaussianFilter(sigmas[0]);
+
+  int max_radius = std::max(_pyr_down.radius, _smooth_down[0].radius);
+  cv::Size s = size;
+  for(size_t i = 1; i < _levels.size(); ++i)
+  {
+    s = LevelSize(s);
+    _levels[i].create(s, CV_8UC1);
+    _smooth_down[i] = MakeFilter(sigmas[i]);
+    max_radius = std::max(max_radius, _smooth_down[i].radius);
+  }
+
+  //
+  // the scratch memory of filter: the row pointers and a row of
+  // vertical sums, which spans the image plus the filter radius on each side
+  //
+  _workspace.reset();
+  _workspace.reserve(
+      Arena::AlignedSize((2*max_radius + 1) * sizeof(const uint8_t*)) +
+      Arena::AlignedSize((size.width + 2*max_radius + 4) * sizeof(int16_t)));
+}
+
+void ImagePyramid::setImage(const cv::Mat& I)
+{
+  THROW_ERROR_IF( I.type() != CV_8UC1, "image must be CV_8UC1" );
+
+  if(I.size() != _size) {
+    RecordAllocation();
+    init(I.size(), _sigmas);
+  }
+
+  _levels[0] = I;
+  for(size_t i = 0; i < _levels.size(); ++i) {
+    _valid[i].clear();
+    _prepared[i].clear();
+  }
+}
+
+bool ImagePyramid::Covers(const Regions& regions, const cv::Rect& roi)
+{
+  for(const auto& r : regions)
+    if((roi & r) == roi)
+      return true;
+
+  return false;
+}
+
+cv::Rect ImagePyramid::Merge(Regions& regions, const cv::Rect& roi)
+{
+  for(auto& r : regions)
+    if((roi & r).area() > 0)
+      return (r |= roi);
+
+  regions.push_back(roi);
+  return roi;
+}
+
+void ImagePyramid::smooth(int i, const cv::Rect& roi, cv::Mat& dst)
+{
+  if(roi.area() <= 0)
+    return;
+
+  if(Covers(_prepared[i], roi)) {
+    _smoothed[i](roi).copyTo(dst(roi));
+    return;
+  }
+
+  //
+  // the coarser levels and the scratch buffers of the filters are shared
+  //
+  std::lock_guard<std::mutex> lock(_mutex);
+  smoothLevel(i, roi, dst);
+}
+
+void ImagePyramid::prepare(int i, const cv::Rect& roi_)
+{
+  const cv::Rect roi = roi_ & cv::Rect(cv::Point(0, 0), _levels[i].size());
+  if(roi.area() <= 0 || Covers(_prepared[i], roi))
+    return;
+
+  if(_smoothed[i].size() != _levels[i].size()) {
+    RecordAllocation();
+    _smoothed[i].create(_levels[i].size(), CV_8UC1);
+  }
+
+  smoothLevel(i, Merge(_prepared[i], roi), _smoothed[i]);
+}
+
+void ImagePyramid::smoothLevel(int i, const cv::Rect& roi, cv::Mat& dst)
+{
+  if(i == 0)
+  {
+    if(_sigmas[0] > 0)
+      filter(_levels[0], _smooth_down[0], 1, roi, dst);
+    else
+      _levels[0](roi).copyTo(dst(roi));
+    return;
+  }
+
+  const Filter& h = _smooth_down[i];
+  update(i - 1, parentRegion(i, roi, h.radius));
+  filter(_levels[i-1], h, 2, roi, dst);
+}
+
+void ImagePyramid::update(int i, const cv::Rect& roi)
+{
+  if(i == 0 || Covers(_valid[i], roi))
+    return;
+
+  //
+  // overlapping regions are merged, but we keep the others apart. Templates
+  // far from each other do not need the pixels between them
+  //
+  const cv::Rect box = Merge(_valid[i], roi);
+  update(i - 1, parentRegion(i, box, _pyr_down.radius));
+  filter(_levels[i-1], _pyr_down, 2, box, _levels[i]);
+}
+
+cv::Rect ImagePyramid::parentRegion(int i, const cv::Rect& roi, int r) const
+{
+  //
+  // the reflected border pixels are within the radius of the image border,
+  // hence they are in the region as well
+  //
+  const cv::Rect box(2*roi.x - r, 2*roi.y - r, 2*roi.width - 1 + 2*r,
+                     2*roi.height - 1 + 2*r);
+  return box & cv::Rect(cv::Point(0, 0), _levels[i-1].size());
+}
+
+void ImagePyramid::filter(const cv::Mat& src, const Filter& h, int step,
+                          const cv::Rect& roi, cv::Mat& dst)
+{
+  const auto& kernels = simd::GetKernels();
+  const int r = h.radius, ksize = 2*r + 1, W = src.cols, H = src.rows;
+
+  //
+  // the input columns [c_lo, c_hi] are needed. Those outside the image are
+  // reflected (BORDER_REFLECT_101), so we filter the columns [a, b] in the
+  // image that cover them
+  //
+  const int c_lo = step*roi.x - r, c_hi = step*(roi.x + roi.width - 1) + r;
+  int a = std::max(c_lo, 0), b = std::min(c_hi, W - 1);
+  if(c_lo < 0)
+    b = std::max(b, std::min(-c_lo, W - 1));
+  if(c_hi >= W)
+    a = std::min(a, std::max(2*(W - 1) - c_hi, 0));
+
+  const int base = std::min(a, c_lo), len = std::max(b, c_hi) - base + 1;
+
+  _workspace.reset();
+  const uint8_t** rows = _workspace.allocate<const uint8_t*>(ksize);
+  int16_t* vsum = _workspace.allocate<int16_t>(len + 4);
+
+  // the horizontal kernel reads a few samples past the row
+  std::memset(vsum + len, 0, 4*sizeof(int16_t));
+
+  for(int y = roi.y; y < roi.y + roi.height; ++y)
+  {
+    for(int k = 0; k < ksize; ++k) {
+      const int yy = cv::borderInterpolate(step*y + k - r, H, cv::BORDER_REFLECT_101);
+      rows[k] = src.ptr<const uint8_t>(yy) + a;
+    }
+
+    kernels.vfilter(rows, h.taps.data(), ksize, b - a + 1, vsum + a - base);
+
+    for(int c = c_lo; c < a; ++c)
+      vsum[c - base] = vsum[cv::borderInterpolate(c, W, cv::BORDER_REFLECT_101) - base];
+    for(int c = b + 1; c <= c_hi; ++c)
+      vsum[c - base] = vsum[cv::borderInterpolate(c, W, cv::BORDER_REFLECT_101) - base];
+
+    const auto hfilter = (step == 1) ? kernels.hfilter : kernels.hfilter_decimate;
+    hfilter(vsum + c_lo - base, h.taps.data(), ksize, roi.width,
+            dst.ptr<uint8_t>(y) + roi.x);
+  }
+}
+
+}; // bp
@@ -0,0 +1,187 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_INTERNAL_IMAGE_PYRAMID_H
+#define BITPLANES_CORE_INTERNAL_IMAGE_PYRAMID_H
+
+#include "bitplanes/utils/memory.h"
+
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace bp {
+
+/**
+ * A Gaussian image pyramid that is computed on demand, only in the regions
+ * that are needed.
+ *
+ * Level 'i' is the level 'i-1' filtered with [1 4 6 4 1]/16 and decimated by
+ * two, as cv::pyrDown does. The trackers need each level pre-smoothed with a
+ * Gaussian of std. deviation sigma[i]. For i > 0, we get it in one pass from
+ * the level i-1, with a filter that combines the pyrDown filter and the
+ * Gaussian at the resolution of level i-1 (std. deviation 2*sigma[i]). The
+ * filters use the buffers allocated by init(), hence smoothing does not
+ * allocate
+ *
+ * Several trackers may share a pyramid across threads. The smoothed regions
+ * are computed beforehand with prepare(), and smooth() only reads them. The
+ * regions that were not prepared are computed under a lock
+ */
+class ImagePyramid
+{
+ public:
+  ImagePyramid() = default;
+
+  /**
+   * Allocates the levels and the scratch buffers
+   *
+   * \param size size of the input images
+   * \param sigmas std. deviation of the pre-smoothing at each level. The
+   * number of levels is sigmas.size()
+   */
+  void init(const cv::Size& size, const std::vector<float>& sigmas);
+
+  /**
+   * Sets the input image (level 0) and invalidates the computed regions. We
+   * keep a reference to I until releaseImage() or the next call to setImage()
+   */
+  void setImage(const cv::Mat& I);
+
+  inline void releaseImage() { _levels[0].release(); }
+
+  inline int numLevels() const { return static_cast<int>(_levels.size()); }
+
+  inline const std::vector<float>& sigmas() const { return _sigmas; }
+
+  /**
+   * \return the size of the input images, set by init()
+   */
+  inline const cv::Size& size() const { return _size; }
+
+  /**
+   * \return the level 'i'. For i > 0, only the parts that were needed by
+   * smooth() hold valid data
+   */
+  inline const cv::Mat& level(int i) const { return _levels[i]; }
+
+  /**
+   * Writes the level 'i', smoothed with sigma[i], to dst(roi). 'dst' must be
+   * allocated to the size of level 'i'.
+   *
+   * This is thread-safe, as long as different threads use different 'dst'
+   */
+  void smooth(int i, const cv::Rect& roi, cv::Mat& dst);
+
+  /**
+   * Computes the level 'i', smoothed with sigma[i], in 'roi'. Later calls to
+   * smooth() inside the prepared regions copy the result. This is not
+   * thread-safe
+   */
+  void prepare(int i, const cv::Rect& roi);
+
+ private:
+  /**
+   * A symmetric filter in fixed-point (see simd::FilterBits). The taps are
+   * padded with a zero if the size is odd
+   */
+  struct Filter
+  {
+    std::vector<int16_t> taps;
+    int radius = 0;
+  }; // Filter
+
+  /**
+   * \return the pyrDown filter combined with the Gaussian of 'sigma' at the
+   * lower resolution
+   */
+  static Filter MakeFilter(float sigma);
+
+  /**
+   * \return the Gaussian of std. deviation 'sigma'
+   */
+  static Filter MakeGaussianFilter(float sigma);
+
+  /**
+   * \return the taps 'h' in fixed point, rounded to sum to one
+   */
+  static Filter ToFixedPoint(const std::vector<float>& h);
+
+  /**
+   * A copyable mutex, copies get their own lock
+   */
+  struct Mutex : std::mutex
+  {
+    Mutex() = default;
+    Mutex(const Mutex&) : std::mutex() {}
+    Mutex& operator=(const Mutex&) { return *this; }
+  }; // Mutex
+
+  typedef std::vector<cv::Rect> Regions;
+
+  /**
+   * \return true if 'roi' is inside one of the regions
+   */
+  static bool Covers(const Regions&, const cv::Rect& roi);
+
+  /**
+   * Adds 'roi' to the regions. If it overlaps a region, the two are merged
+   *
+   * \return the region that holds 'roi'
+   */
+  static cv::Rect Merge(Regions&, const cv::Rect& roi);
+
+  /**
+   * computes level 'i' (not smoothed) in 'roi'
+   */
+  void update(int i, const cv::Rect& roi);
+
+  /**
+   * computes level 'i' smoothed with sigma[i] into dst(roi)
+   */
+  void smoothLevel(int i, const cv::Rect& roi, cv::Mat& dst);
+
+  /**
+   * filters 'src' with 'h' into dst(roi), taking every 'step' pixel (1, or 2
+   * to decimate by two)
+   */
+  void filter(const cv::Mat& src, const Filter& h, int step, const cv::Rect& roi,
+              cv::Mat& dst);
+
+  /**
+   * \return the region of level i-1 that 'roi' at level 'i' depends on
+   */
+  cv::Rect parentRegion(int i, const cv::Rect& roi, int radius) const;
+
+ private:
+  std::vector<cv::Mat> _levels;
+  std::vector<Regions> _valid;      //< regions of the levels that are computed
+  std::vector<cv::Mat> _smoothed;   //< smoothed levels, see prepare()
+  std::vector<Regions> _prepared;   //< regions of _smoothed that are computed
+  std::vector<float> _sigmas;
+  cv::Size _size;                   //< size of the input images
+  Filter _pyr_down;                 //< the pyrDown filter
+  std::vector<Filter> _smooth_down; //< smoothing, with pyrDown for i > 0
+  Arena _workspace;
+  Mutex _mutex;                     //< guards the lazy computations
+}; // ImagePyramid
+
+}; // bp
+
+#endif // BITPLANES_CORE_INTERNAL_IMAGE_PYRAMID_H
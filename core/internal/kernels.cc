@@ -0,0 +1,608 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitplanes/core/internal/kernels.h"
+#include "bitplanes/core/debug.h"
+#include "bitplanes/utils/utils.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86 1
+#include "bitplanes/core/internal/census_signature.h"
+#include <immintrin.h>
+#else
+#define HAVE_X86 0
+#endif
+
+namespace bp {
+namespace simd {
+
+//
+// scalar kernels. These are the reference implementations
+//
+
+static void CensusRowScalar(const uint8_t* r0, const uint8_t* r1,
+                            const uint8_t* r2, int n, uint8_t* dst)
+{
+  for(int x = 0; x < n; ++x)
+  {
+    const uint8_t v = r1[x];
+    dst[x] =
+        ((r0[x-1] >= v) << 0) | ((r0[x  ] >= v) << 1) | ((r0[x+1] >= v) << 2) |
+        ((r1[x-1] >= v) << 3) | ((r1[x+1] >= v) << 4) |
+        ((r2[x-1] >= v) << 5) | ((r2[x  ] >= v) << 6) | ((r2[x+1] >= v) << 7);
+  }
+}
+
+static const int ROUND = 1 << (2*cv::INTER_BITS - 1);
+
+/**
+ * bilinear interpolation at the fixed-point coordinates (ix, iy)
+ */
+static FORCE_INLINE uint8_t
+BilinearAt(const uint8_t* src, int W, int H, int stride, int ix, int iy)
+{
+  const int xs = ix >> cv::INTER_BITS, ys = iy >> cv::INTER_BITS;
+  const int ax = ix & (cv::INTER_TAB_SIZE-1), ay = iy & (cv::INTER_TAB_SIZE-1);
+  const int w00 = (cv::INTER_TAB_SIZE - ax) * (cv::INTER_TAB_SIZE - ay),
+            w01 = ax * (cv::INTER_TAB_SIZE - ay),
+            w10 = (cv::INTER_TAB_SIZE - ax) * ay,
+            w11 = ax * ay;
+
+  int v00, v01, v10, v11;
+  if(xs >= 0 && xs < W - 1 && ys >= 0 && ys < H - 1) {
+    const uint8_t* p = src + ys*stride + xs;
+    v00 = p[0]; v01 = p[1]; v10 = p[stride]; v11 = p[stride+1];
+  } else {
+    auto P = [=](int yy, int xx) {
+      return (xx < 0 || yy < 0 || xx >= W || yy >= H) ? 0 : src[yy*stride + xx];
+    };
+    v00 = P(ys, xs); v01 = P(ys, xs+1); v10 = P(ys+1, xs); v11 = P(ys+1, xs+1);
+  }
+
+  return static_cast<uint8_t>(
+      (w00*v00 + w01*v01 + w10*v10 + w11*v11 + ROUND) >> (2*cv::INTER_BITS));
+}
+
+static void WarpRowScalar(const cv::Mat& I, const Matrix33f& T, int x0, int y,
+                          int n, int step, uint8_t* dst)
+{
+  const int W = I.cols, H = I.rows, stride = static_cast<int>(I.step);
+  const uint8_t* src = I.ptr<const uint8_t>();
+
+  const float a0 = T(0,1)*y + T(0,2),
+              a1 = T(1,1)*y + T(1,2),
+              a2 = T(2,1)*y + T(2,2);
+
+  for(int x = 0; x < n; ++x)
+  {
+    const float xx = static_cast<float>(x*step + x0);
+    const float w = 1.0f / (T(2,0)*xx + a2);
+    const int ix = cv::saturate_cast<int>((T(0,0)*xx + a0) * w * cv::INTER_TAB_SIZE);
+    const int iy = cv::saturate_cast<int>((T(1,0)*xx + a1) * w * cv::INTER_TAB_SIZE);
+    dst[x] = BilinearAt(src, W, H, stride, ix, iy);
+  }
+}
+
+static int AccumulateScalar(const float* J, int dof, const uint8_t* w,
+                            const uint8_t* c, const uint8_t* m, int n, float* g)
+{
+  int ret = 0;
+  for(int i = 0; i < n; ++i, J += 8*dof)
+  {
+    const unsigned d = w[i] ^ c[i];
+    if(!d)
+      continue;
+
+    ret += static_cast<int>( popcount(d) );
+    for(unsigned r = d & w[i] & m[i]; r; r &= r - 1) {
+      const float* row = J + (findFirstSet(r) - 1)*dof;
+      for(int k = 0; k < dof; ++k)
+        g[k] += row[k];
+    }
+
+    for(unsigned r = d & c[i] & m[i]; r; r &= r - 1) {
+      const float* row = J + (findFirstSet(r) - 1)*dof;
+      for(int k = 0; k < dof; ++k)
+        g[k] -= row[k];
+    }
+  }
+
+  return ret;
+}
+
+/**
+ * vertical filter of the columns [x0, n)
+ */
+static FORCE_INLINE void VFilterColumns(const uint8_t* const* rows, const int16_t* h,
+                                        int ksize, int x0, int n, int16_t* dst)
+{
+  for(int x = x0; x < n; ++x)
+  {
+    int v = 0;
+    for(int k = 0; k < ksize; ++k)
+      v += h[k] * rows[k][x];
+    dst[x] = static_cast<int16_t>(v);
+  }
+}
+
+static void VFilterScalar(const uint8_t* const* rows, const int16_t* h,
+                          int ksize, int n, int16_t* dst)
+{
+  VFilterColumns(rows, h, ksize, 0, n, dst);
+}
+
+static const int FILTER_ROUND = 1 << (2*FilterBits - 1);
+
+static void HFilterScalar(const int16_t* src, const int16_t* h,
+                          int ksize, int n, uint8_t* dst)
+{
+  for(int i = 0; i < n; ++i)
+  {
+    int v = 0;
+    for(int k = 0; k < ksize; ++k)
+      v += h[k] * src[i + k];
+    dst[i] = cv::saturate_cast<uint8_t>((v + FILTER_ROUND) >> (2*FilterBits));
+  }
+}
+
+static void HFilterDecimateScalar(const int16_t* src, const int16_t* h,
+                                  int ksize, int n, uint8_t* dst)
+{
+  for(int i = 0; i < n; ++i)
+  {
+    int v = 0;
+    for(int k = 0; k < ksize; ++k)
+      v += h[k] * src[2*i + k];
+    dst[i] = cv::saturate_cast<uint8_t>((v + FILTER_ROUND) >> (2*FilterBits));
+  }
+}
+
+#if HAVE_X86
+
+//
+// SSE2 kernels
+//
+
+/**
+ * census of 'n' pixels, V::Size at a time. The remaining pixels are passed to
+ * 'tail'
+ */
+template <class V, class Tail> static FORCE_INLINE
+void CensusRowSIMD(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2,
+                   int n, uint8_t* dst, Tail tail)
+{
+  int x = 0;
+  for( ; x <= n - V::Size; x += V::Size)
+    CensusSignatureSIMD<V>(r0 + x, r1 + x, r2 + x).storeu(dst + x);
+
+  tail(r0 + x, r1 + x, r2 + x, n - x, dst + x);
+}
+
+static TARGET("sse2")
+void CensusRowSSE2(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2,
+                   int n, uint8_t* dst)
+{
+  CensusRowSIMD<v128>(r0, r1, r2, n, dst, CensusRowScalar);
+}
+
+static TARGET("sse2")
+void WarpRowSSE2(const cv::Mat& I, const Matrix33f& T, int x0, int y,
+                 int n, int step, uint8_t* dst)
+{
+  const int W = I.cols, H = I.rows, stride = static_cast<int>(I.step);
+  const uint8_t* src = I.ptr<const uint8_t>();
+
+  const float a0 = T(0,1)*y + T(0,2),
+              a1 = T(1,1)*y + T(1,2),
+              a2 = T(2,1)*y + T(2,2);
+
+  const __m128 t00 = _mm_set1_ps(T(0,0)), t10 = _mm_set1_ps(T(1,0)),
+        t20 = _mm_set1_ps(T(2,0)), va0 = _mm_set1_ps(a0), va1 = _mm_set1_ps(a1),
+        va2 = _mm_set1_ps(a2), one = _mm_set1_ps(1.0f),
+        tab = _mm_set1_ps(static_cast<float>(cv::INTER_TAB_SIZE)),
+        iota = _mm_mul_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f),
+                          _mm_set1_ps(static_cast<float>(step)));
+
+  alignas(16) int ix[4], iy[4];
+
+  int x = 0;
+  for( ; x <= n - 4; x += 4)
+  {
+    const __m128 xx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x*step + x0)), iota);
+    const __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_mul_ps(t20, xx), va2));
+    const __m128 X = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(t00, xx), va0), w), tab);
+    const __m128 Y = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(t10, xx), va1), w), tab);
+    _mm_store_si128((__m128i*) ix, _mm_cvtps_epi32(X));
+    _mm_store_si128((__m128i*) iy, _mm_cvtps_epi32(Y));
+
+    for(int k = 0; k < 4; ++k)
+      dst[x + k] = BilinearAt(src, W, H, stride, ix[k], iy[k]);
+  }
+
+  WarpRowScalar(I, T, x0 + x*step, y, n - x, step, dst + x);
+}
+
+/**
+ * loads/stores two floats in the low half of a register (the tail of dof 6 and 2)
+ */
+static FORCE_INLINE __m128 LoadLow(const float* p)
+{
+  double d; // p is only 4-byte aligned, memcpy compiles to a movsd
+  std::memcpy(&d, p, sizeof(d));
+  return _mm_castpd_ps(_mm_set_sd(d));
+}
+
+static FORCE_INLINE void StoreLow(float* p, __m128 v)
+{
+  const double d = _mm_cvtsd_f64(_mm_castps_pd(v));
+  std::memcpy(p, &d, sizeof(d));
+}
+
+static TARGET("sse2")
+int AccumulateSSE2(const float* J, int dof, const uint8_t* w,
+                   const uint8_t* c, const uint8_t* m, int n, float* g)
+{
+  if(dof != 8 && dof != 6 && dof != 4 && dof != 2)
+    return AccumulateScalar(J, dof, w, c, m, n, g);
+
+  // g0 holds g[0..3] (dof >= 4), g1 holds g[4..7] (dof 8) and g2 the last two
+  // when dof is 6 or 2
+  const bool has_g0 = dof >= 4, has_g1 = dof == 8, has_g2 = (dof & 2) != 0;
+  const int t = dof - 2;
+  __m128 g0 = has_g0 ? _mm_loadu_ps(g) : _mm_setzero_ps(),
+         g1 = has_g1 ? _mm_loadu_ps(g + 4) : _mm_setzero_ps(),
+         g2 = has_g2 ? LoadLow(g + t) : _mm_setzero_ps();
+
+  int ret = 0;
+  for(int i = 0; i < n; ++i, J += 8*dof)
+  {
+    const unsigned d = w[i] ^ c[i];
+    if(!d)
+      continue;
+
+    ret += static_cast<int>( popcount(d) );
+    for(unsigned r = d & w[i] & m[i]; r; r &= r - 1) {
+      const float* row = J + (findFirstSet(r) - 1)*dof;
+      if(has_g0) g0 = _mm_add_ps(g0, _mm_loadu_ps(row));
+      if(has_g1) g1 = _mm_add_ps(g1, _mm_loadu_ps(row + 4));
+      if(has_g2) g2 = _mm_add_ps(g2, LoadLow(row + t));
+    }
+
+    for(unsigned r = d & c[i] & m[i]; r; r &= r - 1) {
+      const float* row = J + (findFirstSet(r) - 1)*dof;
+      if(has_g0) g0 = _mm_sub_ps(g0, _mm_loadu_ps(row));
+      if(has_g1) g1 = _mm_sub_ps(g1, _mm_loadu_ps(row + 4));
+      if(has_g2) g2 = _mm_sub_ps(g2, LoadLow(row + t));
+    }
+  }
+
+  if(has_g0) _mm_storeu_ps(g, g0);
+  if(has_g1) _mm_storeu_ps(g + 4, g1);
+  if(has_g2) StoreLow(g + t, g2);
+
+  return ret;
+}
+
+static TARGET("sse2")
+void VFilterSSE2(const uint8_t* const* rows, const int16_t* h,
+                 int ksize, int n, int16_t* dst)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  int x = 0;
+  for( ; x <= n - 16; x += 16)
+  {
+    __m128i s0 = zero, s1 = zero;
+    for(int k = 0; k < ksize; ++k)
+    {
+      const __m128i hk = _mm_set1_epi16(h[k]);
+      const __m128i p = _mm_loadu_si128((const __m128i*) (rows[k] + x));
+      s0 = _mm_add_epi16(s0, _mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), hk));
+      s1 = _mm_add_epi16(s1, _mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), hk));
+    }
+
+    _mm_storeu_si128((__m128i*) (dst + x), s0);
+    _mm_storeu_si128((__m128i*) (dst + x + 8), s1);
+  }
+
+  VFilterColumns(rows, h, ksize, x, n, dst);
+}
+
+static TARGET("sse2")
+void HFilterSSE2(const int16_t* src, const int16_t* h,
+                 int ksize, int n, uint8_t* dst)
+{
+  const __m128i round = _mm_set1_epi32(FILTER_ROUND);
+
+  //
+  // the taps (h[k], h[k+1]) multiply (src[i+k], src[i+k+1]) for the output
+  // 'i', which is a single madd on the samples interleaved with themselves
+  // shifted by one
+  //
+  int i = 0;
+  for( ; i <= n - 8; i += 8)
+  {
+    __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128();
+    for(int k = 0; k < ksize; k += 2)
+    {
+      const __m128i a = _mm_loadu_si128((const __m128i*) (src + i + k));
+      const __m128i b = _mm_loadu_si128((const __m128i*) (src + i + k + 1));
+      const __m128i hk = _mm_set1_epi32(
+          (static_cast<uint16_t>(h[k+1]) << 16) | static_cast<uint16_t>(h[k]));
+
+      s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), hk));
+      s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), hk));
+    }
+
+    s0 = _mm_srai_epi32(_mm_add_epi32(s0, round), 2*FilterBits);
+    s1 = _mm_srai_epi32(_mm_add_epi32(s1, round), 2*FilterBits);
+    const __m128i v = _mm_packs_epi32(s0, s1);
+    _mm_storel_epi64((__m128i*) (dst + i), _mm_packus_epi16(v, v));
+  }
+
+  HFilterScalar(src + i, h, ksize, n - i, dst + i);
+}
+
+static TARGET("sse2")
+void HFilterDecimateSSE2(const int16_t* src, const int16_t* h,
+                         int ksize, int n, uint8_t* dst)
+{
+  const __m128i round = _mm_set1_epi32(FILTER_ROUND);
+
+  //
+  // with the even and odd samples E[t] = src[2t], O[t] = src[2t+1], the taps
+  // (h[2m], h[2m+1]) multiply (E[i+m], O[i+m]) for the output 'i', which is
+  // a single madd on the interleaved samples
+  //
+  int i = 0;
+  for( ; i <= n - 8; i += 8)
+  {
+    __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128();
+    for(int k = 0; k < ksize; k += 2)
+    {
+      const __m128i a = _mm_loadu_si128((const __m128i*) (src + 2*i + k));
+      const __m128i b = _mm_loadu_si128((const __m128i*) (src + 2*i + k + 8));
+      const __m128i e = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                        _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+      const __m128i o = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+      const __m128i hk = _mm_set1_epi32(
+          (static_cast<uint16_t>(h[k+1]) << 16) | static_cast<uint16_t>(h[k]));
+
+      s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi16(e, o), hk));
+      s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi16(e, o), hk));
+    }
+
+    s0 = _mm_srai_epi32(_mm_add_epi32(s0, round), 2*FilterBits);
+    s1 = _mm_srai_epi32(_mm_add_epi32(s1, round), 2*FilterBits);
+    const __m128i v = _mm_packs_epi32(s0, s1);
+    _mm_storel_epi64((__m128i*) (dst + i), _mm_packus_epi16(v, v));
+  }
+
+  HFilterDecimateScalar(src + 2*i, h, ksize, n - i, dst + i);
+}
+
+//
+// AVX2 kernels
+//
+
+static TARGET("avx2")
+void CensusRowAVX2(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2,
+                   int n, uint8_t* dst)
+{
+  CensusRowSIMD<v256>(r0, r1, r2, n, dst, CensusRowSSE2);
+}
+
+static TARGET("avx2")
+void WarpRowAVX2(const cv::Mat& I, const Matrix33f& T, int x0, int y,
+                 int n, int step, uint8_t* dst)
+{
+  const int W = I.cols, H = I.rows, stride = static_cast<int>(I.step);
+  const uint8_t* src = I.ptr<const uint8_t>();
+
+  const float a0 = T(0,1)*y + T(0,2),
+              a1 = T(1,1)*y + T(1,2),
+              a2 = T(2,1)*y + T(2,2);
+
+  const __m256 t00 = _mm256_set1_ps(T(0,0)), t10 = _mm256_set1_ps(T(1,0)),
+        t20 = _mm256_set1_ps(T(2,0)), va0 = _mm256_set1_ps(a0),
+        va1 = _mm256_set1_ps(a1), va2 = _mm256_set1_ps(a2),
+        one = _mm256_set1_ps(1.0f),
+        tab = _mm256_set1_ps(static_cast<float>(cv::INTER_TAB_SIZE)),
+        iota = _mm256_mul_ps(_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f),
+                             _mm256_set1_ps(static_cast<float>(step)));
+
+  const __m256i frac = _mm256_set1_epi32(cv::INTER_TAB_SIZE - 1),
+        vtab = _mm256_set1_epi32(cv::INTER_TAB_SIZE),
+        byte = _mm256_set1_epi32(0xff), vround = _mm256_set1_epi32(ROUND),
+        vstride = _mm256_set1_epi32(stride), minus_one = _mm256_set1_epi32(-1),
+        // the gather reads 4 bytes at the top-left pixel of each row
+        x_max = _mm256_set1_epi32(W - 3), y_max = _mm256_set1_epi32(H - 1);
+
+  alignas(32) int ix[8], iy[8];
+
+  int x = 0;
+  for( ; x <= n - 8; x += 8)
+  {
+    const __m256 xx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x*step + x0)), iota);
+    const __m256 w = _mm256_div_ps(one, _mm256_add_ps(_mm256_mul_ps(t20, xx), va2));
+    const __m256 X = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(t00, xx), va0), w), tab);
+    const __m256 Y = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(t10, xx), va1), w), tab);
+    const __m256i vix = _mm256_cvtps_epi32(X), viy = _mm256_cvtps_epi32(Y);
+
+    const __m256i xs = _mm256_srai_epi32(vix, cv::INTER_BITS),
+          ys = _mm256_srai_epi32(viy, cv::INTER_BITS);
+
+    const __m256i inside = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpgt_epi32(xs, minus_one), _mm256_cmpgt_epi32(x_max, xs)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(ys, minus_one), _mm256_cmpgt_epi32(y_max, ys)));
+
+    if(_mm256_movemask_ps(_mm256_castsi256_ps(inside)) != 0xff)
+    {
+      // some pixels are near the border
+      _mm256_store_si256((__m256i*) ix, vix);
+      _mm256_store_si256((__m256i*) iy, viy);
+      for(int k = 0; k < 8; ++k)
+        dst[x + k] = BilinearAt(src, W, H, stride, ix[k], iy[k]);
+      continue;
+    }
+
+    const __m256i off = _mm256_add_epi32(_mm256_mullo_epi32(ys, vstride), xs);
+    const __m256i top = _mm256_i32gather_epi32((const int*) src, off, 1);
+    const __m256i bot = _mm256_i32gather_epi32((const int*) (src + stride), off, 1);
+
+    const __m256i ax = _mm256_and_si256(vix, frac), ay = _mm256_and_si256(viy, frac);
+    const __m256i bx = _mm256_sub_epi32(vtab, ax), by = _mm256_sub_epi32(vtab, ay);
+
+    const __m256i v00 = _mm256_and_si256(top, byte),
+          v01 = _mm256_and_si256(_mm256_srli_epi32(top, 8), byte),
+          v10 = _mm256_and_si256(bot, byte),
+          v11 = _mm256_and_si256(_mm256_srli_epi32(bot, 8), byte);
+
+    __m256i s = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_mullo_epi32(_mm256_mullo_epi32(bx, by), v00),
+                         _mm256_mullo_epi32(_mm256_mullo_epi32(ax, by), v01)),
+        _mm256_add_epi32(_mm256_mullo_epi32(_mm256_mullo_epi32(bx, ay), v10),
+                         _mm256_mullo_epi32(_mm256_mullo_epi32(ax, ay), v11)));
+    s = _mm256_srli_epi32(_mm256_add_epi32(s, vround), 2*cv::INTER_BITS);
+
+    const __m128i s16 = _mm_packus_epi32(_mm256_castsi256_si128(s),
+                                         _mm256_extracti128_si256(s, 1));
+    _mm_storel_epi64((__m128i*) (dst + x), _mm_packus_epi16(s16, s16));
+  }
+
+  WarpRowSSE2(I, T, x0 + x*step, y, n - x, step, dst + x);
+}
+
+static TARGET("avx2,popcnt")
+int AccumulateAVX2(const float* J, int dof, const uint8_t* w,
+                   const uint8_t* c, const uint8_t* m, int n, float* g)
+{
+  if(dof != 8)
+    return AccumulateSSE2(J, dof, w, c, m, n, g);
+
+  __m256 acc = _mm256_loadu_ps(g);
+
+  int ret = 0;
+  for(int i = 0; i < n; ++i, J += 64)
+  {
+    const unsigned d = w[i] ^ c[i];
+    if(!d)
+      continue;
+
+    ret += __builtin_popcount(d);
+    for(unsigned r = d & w[i] & m[i]; r; r &= r - 1)
+      acc = _mm256_add_ps(acc, _mm256_loadu_ps(J + 8*__builtin_ctz(r)));
+    for(unsigned r = d & c[i] & m[i]; r; r &= r - 1)
+      acc = _mm256_sub_ps(acc, _mm256_loadu_ps(J + 8*__builtin_ctz(r)));
+  }
+
+  _mm256_storeu_ps(g, acc);
+  return ret;
+}
+
+static TARGET("avx2")
+void VFilterAVX2(const uint8_t* const* rows, const int16_t* h,
+                 int ksize, int n, int16_t* dst)
+{
+  int x = 0;
+  for( ; x <= n - 32; x += 32)
+  {
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    for(int k = 0; k < ksize; ++k)
+    {
+      const __m256i hk = _mm256_set1_epi16(h[k]);
+      const __m256i p0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (rows[k] + x)));
+      const __m256i p1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (rows[k] + x + 16)));
+      s0 = _mm256_add_epi16(s0, _mm256_mullo_epi16(p0, hk));
+      s1 = _mm256_add_epi16(s1, _mm256_mullo_epi16(p1, hk));
+    }
+
+    _mm256_storeu_si256((__m256i*) (dst + x), s0);
+    _mm256_storeu_si256((__m256i*) (dst + x + 16), s1);
+  }
+
+  VFilterColumns(rows, h, ksize, x, n, dst);
+}
+
+#if BITPLANES_HAVE_V512
+
+//
+// AVX-512 kernels. Only the census is wider, the others use AVX2 (or SSE2)
+//
+
+static TARGET("avx512f,avx512bw")
+void CensusRowAVX512(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2,
+                     int n, uint8_t* dst)
+{
+  CensusRowSIMD<v512>(r0, r1, r2, n, dst, CensusRowAVX2);
+}
+
+#endif // BITPLANES_HAVE_V512
+
+#endif // HAVE_X86
+
+static const Kernels ScalarKernels = {
+  CensusRowScalar, WarpRowScalar, AccumulateScalar,
+  VFilterScalar, HFilterScalar, HFilterDecimateScalar
+};
+
+#if HAVE_X86
+static const Kernels SSE2Kernels = {
+  CensusRowSSE2, WarpRowSSE2, AccumulateSSE2,
+  VFilterSSE2, HFilterSSE2, HFilterDecimateSSE2
+};
+
+static const Kernels AVX2Kernels = {
+  CensusRowAVX2, WarpRowAVX2, AccumulateAVX2,
+  VFilterAVX2, HFilterSSE2, HFilterDecimateSSE2
+};
+
+#if BITPLANES_HAVE_V512
+static const Kernels AVX512Kernels = {
+  CensusRowAVX512, WarpRowAVX2, AccumulateAVX2,
+  VFilterAVX2, HFilterSSE2, HFilterDecimateSSE2
+};
+#else
+static const Kernels& AVX512Kernels = AVX2Kernels;
+#endif
+#endif
+
+const Kernels& GetKernels(SimdLevel level)
+{
+  switch(level)
+  {
+#if HAVE_X86
+    case SimdLevel::AVX512: return AVX512Kernels;
+    case SimdLevel::AVX2: return AVX2Kernels;
+    case SimdLevel::SSE2: return SSE2Kernels;
+#endif
+    default: return ScalarKernels;
+  }
+}
+
+const Kernels& GetKernels()
+{
+  return GetKernels(GetSimdLevel());
+}
+
+}; // simd
+}; // bp
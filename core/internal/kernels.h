@@ -0,0 +1,129 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_INTERNAL_KERNELS_H
+#define BITPLANES_CORE_INTERNAL_KERNELS_H
+
+#include "bitplanes/core/cpu.h"
+#include "bitplanes/core/types.h"
+#include "bitplanes/core/internal/cvfwd.h"
+
+#include <cstdint>
+
+namespace bp {
+namespace simd {
+
+/**
+ * Computes the census signature of 'n' consecutive pixels
+ *
+ * \param r0 the row above
+ * \param r1 the row with the center pixels
+ * \param r2 the row below
+ * \param n  number of pixels
+ * \param dst output signatures
+ *
+ * The kernel reads r[-1] ... r[n] from each row
+ */
+typedef void (*CensusRowKernel)(const uint8_t* r0, const uint8_t* r1,
+                                const uint8_t* r2, int n, uint8_t* dst);
+
+/**
+ * Warps 'n' pixels of the row 'y' starting at column 'x0' with bilinear
+ * interpolation, i.e. dst[i] = I(T * [x0 + i*step, y, 1]). Pixels outside the
+ * image are set to zero.
+ *
+ * All implementations give the same result as cv::remap with INTER_LINEAR and
+ * BORDER_CONSTANT
+ */
+typedef void (*WarpRowKernel)(const cv::Mat& I, const Matrix33f& T, int x0,
+                              int y, int n, int step, uint8_t* dst);
+
+/**
+ * Accumulates the gradient of the cost function for 'n' pixels given the
+ * warped census 'w', the template census 'c' and the mask 'm' of channels with
+ * a non-zero Jacobian row. The rows of channels where w and c differ are added
+ * (w = 1) or subtracted (c = 1) to 'g'
+ *
+ * \param J Jacobian, row-major, 8 rows per pixel
+ * \param dof number of columns of J
+ * \return the number of channels that differ (sum of squared residuals)
+ */
+typedef int (*AccumulateKernel)(const float* J, int dof, const uint8_t* w,
+                                const uint8_t* c, const uint8_t* m, int n,
+                                float* g);
+
+/**
+ * Number of fractional bits of the filter taps, i.e. the taps of a filter sum
+ * to 1 << FilterBits. With 7 bits the vertical sums of 8-bit pixels fit in
+ * int16_t
+ */
+static constexpr int FilterBits = 7;
+
+/**
+ * Filters 'n' columns vertically, dst[x] = sum_k h[k] * rows[k][x]
+ *
+ * \param rows 'ksize' input rows
+ * \param h    filter taps, non-negative and summing to 1 << FilterBits
+ * \param dst  output sums, in units of 2^-FilterBits
+ */
+typedef void (*VFilterKernel)(const uint8_t* const* rows, const int16_t* h,
+                              int ksize, int n, int16_t* dst);
+
+/**
+ * Filters a row of vertical sums horizontally, i.e.
+ * dst[i] = round(sum_k h[k] * src[i + k] / 2^(2*FilterBits)).
+ *
+ * The kernel reads src[0] ... src[n + ksize]. 'h' is padded with a zero tap
+ * if 'ksize' is odd, hence h[ksize] must be readable
+ */
+typedef void (*HFilterKernel)(const int16_t* src, const int16_t* h,
+                              int ksize, int n, uint8_t* dst);
+
+/**
+ * Filters a row of vertical sums horizontally and decimates it by two, i.e.
+ * dst[i] = round(sum_k h[k] * src[2*i + k] / 2^(2*FilterBits)).
+ *
+ * The kernel reads src[0] ... src[2*n + ksize]. 'h' is padded with a zero tap
+ * if 'ksize' is odd, hence h[ksize] must be readable
+ */
+typedef void (*HFilterDecimateKernel)(const int16_t* src, const int16_t* h,
+                                      int ksize, int n, uint8_t* dst);
+
+struct Kernels
+{
+  CensusRowKernel  census_row;
+  WarpRowKernel    warp_row;
+  AccumulateKernel accumulate;
+  VFilterKernel    vfilter;
+  HFilterKernel    hfilter;
+  HFilterDecimateKernel hfilter_decimate;
+}; // Kernels
+
+/**
+ * \return the kernels for the current SimdLevel (see bp::GetSimdLevel)
+ */
+const Kernels& GetKernels();
+
+/**
+ * \return the kernels for the given level. The CPU must support it
+ */
+const Kernels& GetKernels(SimdLevel);
+
+}; // simd
+}; // bp
+
+#endif // BITPLANES_CORE_INTERNAL_KERNELS_H
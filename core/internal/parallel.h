@@ -0,0 +1,67 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_INTERNAL_PARALLEL_H
+#define BITPLANES_CORE_INTERNAL_PARALLEL_H
+
+#include "bitplanes/core/config.h"
+
+#if BITPLANES_WITH_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+namespace bp {
+
+/**
+ * calls f(i) for i in [0, n), in parallel with TBB or OpenMP. A single item
+ * runs in the calling thread.
+ *
+ * With OpenMP, a ParallelFor inside another parallel region runs serially
+ */
+template <class Func> inline
+void ParallelFor(int n, Func&& f)
+{
+#if BITPLANES_WITH_TBB
+  if(n > 1)
+    tbb::parallel_for(0, n, f);
+  else if(n == 1)
+    f(0);
+#else
+#if BITPLANES_WITH_OPENMP
+#pragma omp parallel for schedule(static) if(n > 1)
+#endif
+  for(int i = 0; i < n; ++i)
+    f(i);
+#endif
+}
+
+/**
+ * combines n partial results pairwise with add(i, j), which adds the result
+ * 'j' to 'i'. The order is fixed, hence the total (in 0) is the same whichever
+ * threads computed the partial results
+ */
+template <class Func> inline
+void PairwiseReduce(int n, Func&& add)
+{
+  for(int stride = 1; stride < n; stride *= 2)
+    for(int i = 0; i + stride < n; i += 2*stride)
+      add(i, i + stride);
+}
+
+}; // bp
+
+#endif // BITPLANES_CORE_INTERNAL_PARALLEL_H
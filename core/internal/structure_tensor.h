@@ -0,0 +1,70 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_INTERNAL_STRUCTURE_TENSOR_H
+#define BITPLANES_CORE_INTERNAL_STRUCTURE_TENSOR_H
+
+#include "bitplanes/core/types.h"
+#include "bitplanes/utils/utils.h"
+
+#include <cstdint>
+
+namespace bp {
+
+/**
+ * \return sum_b a_b * c_b, where a_b and c_b are in {-1, 0, 1}. The channel
+ * values are given as the bit masks of the channels with a positive and a
+ * negative value
+ */
+inline int ChannelDot(uint8_t a_pos, uint8_t a_neg, uint8_t c_pos, uint8_t c_neg)
+{
+  return static_cast<int>( popcount(unsigned((a_pos & c_pos) | (a_neg & c_neg))) ) -
+         static_cast<int>( popcount(unsigned((a_pos & c_neg) | (a_neg & c_pos))) );
+}
+
+/**
+ * \return S = sum_b G_b^T * G_b, where G_b is the 1x2 gradient of the census
+ * channel 'b' at a pixel. The gradient components are in {-0.5, 0, 0.5}, they
+ * are given as the bit masks of the channels with a positive and a negative
+ * value
+ */
+inline Eigen::Matrix2f StructureTensor(uint8_t gx_pos, uint8_t gx_neg,
+                                       uint8_t gy_pos, uint8_t gy_neg)
+{
+  const int sxx = static_cast<int>( popcount(unsigned(gx_pos | gx_neg)) ),
+            syy = static_cast<int>( popcount(unsigned(gy_pos | gy_neg)) ),
+            sxy = ChannelDot(gx_pos, gx_neg, gy_pos, gy_neg);
+
+  Eigen::Matrix2f S;
+  S << sxx, sxy, sxy, syy;
+  return 0.25f * S;
+}
+
+/**
+ * Adds the Hessian of a pixel to H. The eight channels of the pixel share the
+ * warp Jacobian Jw, hence the sum of their rank-1 updates (G_b Jw)^T (G_b Jw)
+ * is Jw^T * S * Jw, where S is the structure tensor of the pixel
+ */
+template <class WarpJacobian, class Hessian> inline
+void AddPixelHessian(const Eigen::Matrix2f& S, const WarpJacobian& Jw, Hessian& H)
+{
+  H.noalias() += Jw.transpose() * (S * Jw).eval();
+}
+
+}; // bp
+
+#endif // BITPLANES_CORE_INTERNAL_STRUCTURE_TENSOR_H
@@ -17,6 +17,8 @@
 
 #include "bitplanes/core/config.h"
 #include "bitplanes/core/internal/v128.h"
+#include "bitplanes/core/internal/v256.h"
+#include "bitplanes/core/internal/v512.h"
 #include <iostream>
 
 namespace bp {
@@ -38,4 +40,30 @@ namespace bp {
   }
 #endif
 
+#if BITPLANES_HAVE_V256
+  TARGET("avx2")
+  std::ostream& operator<<(std::ostream& os, const v256& v)
+  {
+    ALIGNED(32) uint8_t buf[32];
+    v.store(buf);
+
+    for(int i = 0; i < 32; ++i)
+      os << static_cast<int>( buf[i] ) << " ";
+    return os;
+  }
+#endif
+
+#if BITPLANES_HAVE_V512
+  TARGET("avx512f,avx512bw")
+  std::ostream& operator<<(std::ostream& os, const v512& v)
+  {
+    ALIGNED(64) uint8_t buf[64];
+    v.store(buf);
+
+    for(int i = 0; i < 64; ++i)
+      os << static_cast<int>( buf[i] ) << " ";
+    return os;
+  }
+#endif
+
 }
@@ -35,6 +35,8 @@ namespace bp {
  */
 struct v128
 {
+  static constexpr int Size = 16; //< number of bytes
+
   __m128i _xmm; //< the vector
 
   FORCE_INLINE v128() {}
@@ -79,6 +81,11 @@ struct v128
     _mm_store_si128((__m128i*) p, _xmm);
   }
 
+  FORCE_INLINE void storeu(void* p) const
+  {
+    _mm_storeu_si128((__m128i*) p, _xmm);
+  }
+
   /**
    * stores the 16 byte values as 16 floats
    */
@@ -155,12 +162,13 @@ FORCE_INLINE v128 operator^(v128 a, v128 b)
   return _mm_xor_si128(a, b);
 }
 
-#if 0
-FORCE_INLINE v128 operator>>(v128 a, const int i)
+/**
+ * logical shift right of the 32-bit lanes
+ */
+FORCE_INLINE v128 operator>>(v128 a, int n)
 {
-  return _mm_srli_epi32(a, i);
+  return _mm_srl_epi32(a, _mm_cvtsi32_si128(n));
 }
-#endif
 
 template <int imm> FORCE_INLINE v128 SHIFT_RIGHT(v128 a)
 {
@@ -0,0 +1,171 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_INTERNAL_V256_H
+#define BITPLANES_CORE_INTERNAL_V256_H
+
+#include "bitplanes/core/debug.h"
+
+#include <iosfwd>
+#include <cinttypes>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BITPLANES_HAVE_V256 1
+#include <immintrin.h>
+#else
+#define BITPLANES_HAVE_V256 0
+#endif
+
+#if BITPLANES_HAVE_V256
+
+/**
+ * The operations are compiled for AVX2 regardless of the compiler flags, the
+ * caller must make sure the CPU supports it (see bp::GetSimdLevel). They are
+ * not FORCE_INLINE, such that generic code templated on the vector type (e.g.
+ * CensusSignatureSIMD<v256>) compiles. They are inlined once the generic code
+ * is inlined in a function with TARGET("avx2")
+ */
+#define V256_INLINE inline TARGET("avx2")
+
+namespace bp {
+
+/**
+ * Holds a vector of 32 bytes (256 bits)
+ */
+struct v256
+{
+  static constexpr int Size = 32; //< number of bytes
+
+  __m256i _ymm; //< the vector
+
+  V256_INLINE v256() {}
+
+  /**
+   * loads the data from vector (unaligned load)
+   */
+  V256_INLINE v256(const uint8_t* p)
+      : _ymm(_mm256_loadu_si256((const __m256i*)p)) {}
+
+  /**
+   * assign from __m256i
+   */
+  V256_INLINE v256(__m256i x) : _ymm(x) {}
+
+  /**
+   * set to constant
+   */
+  V256_INLINE v256(int n) : _ymm(_mm256_set1_epi8(static_cast<char>(n))) {}
+
+  V256_INLINE const v256& load(const uint8_t* p)
+  {
+    _ymm = _mm256_load_si256((const __m256i*) p);
+    return *this;
+  }
+
+  V256_INLINE const v256& loadu(const uint8_t* p)
+  {
+    _ymm = _mm256_loadu_si256((const __m256i*) p);
+    return *this;
+  }
+
+  V256_INLINE operator __m256i() const { return _ymm; }
+
+  V256_INLINE v256 Zero()    { return _mm256_setzero_si256(); }
+  V256_INLINE v256 InvZero() { return v256(0xff); }
+  V256_INLINE v256 One()     { return v256(0x01); }
+
+  V256_INLINE void store(void* p) const
+  {
+    _mm256_store_si256((__m256i*) p, _ymm);
+  }
+
+  V256_INLINE void storeu(void* p) const
+  {
+    _mm256_storeu_si256((__m256i*) p, _ymm);
+  }
+
+  friend std::ostream& operator<<(std::ostream&, const v256&);
+}; // v256
+
+V256_INLINE v256 max(v256 a, v256 b)
+{
+  return _mm256_max_epu8(a, b);
+}
+
+V256_INLINE v256 min(v256 a, v256 b)
+{
+  return _mm256_min_epu8(a, b);
+}
+
+V256_INLINE v256 operator==(v256 a, v256 b)
+{
+  return _mm256_cmpeq_epi8(a, b);
+}
+
+V256_INLINE v256 operator>=(v256 a, v256 b)
+{
+  return (a == max(a, b));
+}
+
+V256_INLINE v256 operator>(v256 a, v256 b)
+{
+  return _mm256_andnot_si256( min(a, b) == a, _mm256_set1_epi8(-1) );
+}
+
+V256_INLINE v256 operator<(v256 a, v256 b)
+{
+  return _mm256_andnot_si256( max(a, b) == a, _mm256_set1_epi8(-1) );
+}
+
+V256_INLINE v256 operator<=(v256 a, v256 b)
+{
+  return (a == min(a, b));
+}
+
+V256_INLINE v256 operator&(v256 a, v256 b)
+{
+  return _mm256_and_si256(a, b);
+}
+
+V256_INLINE v256 operator|(v256 a, v256 b)
+{
+  return _mm256_or_si256(a, b);
+}
+
+V256_INLINE v256 operator^(v256 a, v256 b)
+{
+  return _mm256_xor_si256(a, b);
+}
+
+/**
+ * logical shift right of the 32-bit lanes (same as v128)
+ */
+V256_INLINE v256 operator>>(v256 a, int n)
+{
+  return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n));
+}
+
+template <int imm> V256_INLINE v256 SHIFT_RIGHT(v256 a)
+{
+  return _mm256_srli_epi32(a, imm);
+}
+
+}; // bp
+
+#endif // BITPLANES_HAVE_V256
+
+#endif // BITPLANES_CORE_INTERNAL_V256_H
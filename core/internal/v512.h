@@ -0,0 +1,177 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_INTERNAL_V512_H
+#define BITPLANES_CORE_INTERNAL_V512_H
+
+#include "bitplanes/core/debug.h"
+
+#include <iosfwd>
+#include <cinttypes>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define BITPLANES_HAVE_V512 1
+#include <immintrin.h>
+#else
+#define BITPLANES_HAVE_V512 0
+#endif
+
+#if BITPLANES_HAVE_V512
+
+/**
+ * The operations are compiled for AVX-512 (F and BW) regardless of the compiler
+ * flags, the caller must make sure the CPU supports it (see bp::GetSimdLevel).
+ * They are not FORCE_INLINE, such that generic code templated on the vector
+ * type (e.g. CensusSignatureSIMD<v512>) compiles. They are inlined once the
+ * generic code is inlined in a function with TARGET("avx512f,avx512bw")
+ */
+#define V512_INLINE inline TARGET("avx512f,avx512bw")
+
+namespace bp {
+
+/**
+ * Holds a vector of 64 bytes (512 bits)
+ */
+struct v512
+{
+  static constexpr int Size = 64; //< number of bytes
+
+  __m512i _zmm; //< the vector
+
+  V512_INLINE v512() {}
+
+  /**
+   * loads the data from vector (unaligned load)
+   */
+  V512_INLINE v512(const uint8_t* p)
+      : _zmm(_mm512_loadu_si512((const __m512i*)p)) {}
+
+  /**
+   * assign from __m512i
+   */
+  V512_INLINE v512(__m512i x) : _zmm(x) {}
+
+  /**
+   * set to constant
+   */
+  V512_INLINE v512(int n) : _zmm(_mm512_set1_epi8(static_cast<char>(n))) {}
+
+  V512_INLINE const v512& load(const uint8_t* p)
+  {
+    _zmm = _mm512_load_si512((const __m512i*) p);
+    return *this;
+  }
+
+  V512_INLINE const v512& loadu(const uint8_t* p)
+  {
+    _zmm = _mm512_loadu_si512((const __m512i*) p);
+    return *this;
+  }
+
+  V512_INLINE operator __m512i() const { return _zmm; }
+
+  V512_INLINE v512 Zero()    { return _mm512_setzero_si512(); }
+  V512_INLINE v512 InvZero() { return v512(0xff); }
+  V512_INLINE v512 One()     { return v512(0x01); }
+
+  V512_INLINE void store(void* p) const
+  {
+    _mm512_store_si512((__m512i*) p, _zmm);
+  }
+
+  V512_INLINE void storeu(void* p) const
+  {
+    _mm512_storeu_si512((__m512i*) p, _zmm);
+  }
+
+  friend std::ostream& operator<<(std::ostream&, const v512&);
+}; // v512
+
+V512_INLINE v512 max(v512 a, v512 b)
+{
+  return _mm512_max_epu8(a, b);
+}
+
+V512_INLINE v512 min(v512 a, v512 b)
+{
+  return _mm512_min_epu8(a, b);
+}
+
+//
+// AVX-512 comparisons give a bit mask, we expand it to 0x00/0xff bytes to
+// keep the same semantics as v128 and v256
+//
+
+V512_INLINE v512 operator==(v512 a, v512 b)
+{
+  return _mm512_movm_epi8(_mm512_cmpeq_epu8_mask(a, b));
+}
+
+V512_INLINE v512 operator>=(v512 a, v512 b)
+{
+  return _mm512_movm_epi8(_mm512_cmpge_epu8_mask(a, b));
+}
+
+V512_INLINE v512 operator>(v512 a, v512 b)
+{
+  return _mm512_movm_epi8(_mm512_cmpgt_epu8_mask(a, b));
+}
+
+V512_INLINE v512 operator<(v512 a, v512 b)
+{
+  return _mm512_movm_epi8(_mm512_cmplt_epu8_mask(a, b));
+}
+
+V512_INLINE v512 operator<=(v512 a, v512 b)
+{
+  return _mm512_movm_epi8(_mm512_cmple_epu8_mask(a, b));
+}
+
+V512_INLINE v512 operator&(v512 a, v512 b)
+{
+  return _mm512_and_si512(a, b);
+}
+
+V512_INLINE v512 operator|(v512 a, v512 b)
+{
+  return _mm512_or_si512(a, b);
+}
+
+V512_INLINE v512 operator^(v512 a, v512 b)
+{
+  return _mm512_xor_si512(a, b);
+}
+
+/**
+ * logical shift right of the 32-bit lanes (same as v128)
+ */
+V512_INLINE v512 operator>>(v512 a, int n)
+{
+  return _mm512_srl_epi32(a, _mm_cvtsi32_si128(n));
+}
+
+template <int imm> V512_INLINE v512 SHIFT_RIGHT(v512 a)
+{
+  return _mm512_srli_epi32(a, imm);
+}
+
+}; // bp
+
+#endif // BITPLANES_HAVE_V512
+
+#endif // BITPLANES_CORE_INTERNAL_V512_H
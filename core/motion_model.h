@@ -55,6 +55,11 @@ class MotionModel
     return Derived::MatrixToParams(p);
   }
 
+  static inline float ParamsNorm(const Transform& T)
+  {
+    return Derived::ParamsNorm(T);
+  }
+
   static inline ParameterVector Solve(const Hessian& H, const Gradient& g)
   {
     return Derived::Solve(H, g);
@@ -73,6 +78,10 @@ class MotionModel
     Derived::ComputeJacobian(J, x, y, Ix, Iy, args...);
   }
 
+  /**
+   * The models define ComputeWarpJacobian in their headers, so that it can be
+   * inlined in the linearization loops
+   */
   template <class ... Args> static inline
   WarpJacobian ComputeWarpJacobian(float x, float y, Args& ... args)
   {
@@ -37,7 +37,7 @@ template<> struct motion_model_traits<Homography>
   typedef Eigen::Matrix<float, DOF, 1>       ParameterVector;
   typedef Eigen::Matrix<float, 1, DOF>       Jacobian;
   typedef ParameterVector                    Gradient;
-  typedef Eigen::Matrix<float, Dynamic, DOF> JacobianMatrix;
+  typedef Eigen::Matrix<float, Dynamic, DOF, Eigen::RowMajor> JacobianMatrix;
   typedef Eigen::Matrix<float, 2, DOF>       WarpJacobian;
 };
 
@@ -50,7 +50,7 @@ template<> struct motion_model_traits<Affine>
   typedef Eigen::Matrix<float, DOF, 1>       ParameterVector;
   typedef Eigen::Matrix<float, 1, DOF>       Jacobian;
   typedef ParameterVector                    Gradient;
-  typedef Eigen::Matrix<float, Dynamic, DOF> JacobianMatrix;
+  typedef Eigen::Matrix<float, Dynamic, DOF, Eigen::RowMajor> JacobianMatrix;
   typedef Eigen::Matrix<float, 2, DOF>       WarpJacobian;
 };
 
@@ -63,7 +63,7 @@ template<> struct motion_model_traits<Translation>
   typedef Eigen::Matrix<float, DOF, 1>       ParameterVector;
   typedef Eigen::Matrix<float, 1, DOF>       Jacobian;
   typedef ParameterVector                    Gradient;
-  typedef Eigen::Matrix<float, Dynamic, DOF> JacobianMatrix;
+  typedef Eigen::Matrix<float, Dynamic, DOF, Eigen::RowMajor> JacobianMatrix;
   typedef Eigen::Matrix<float, 2, DOF>       WarpJacobian;
 };
 
@@ -0,0 +1,80 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitplanes/core/multi_template_tracker.h"
+#include "bitplanes/core/homography.h"
+#include "bitplanes/core/affine.h"
+#include "bitplanes/core/translation.h"
+
+#if BITPLANES_WITH_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+namespace bp {
+
+template <class M>
+int MultiTemplateTracker<M>::addTemplate(const cv::Mat& I, const cv::Rect& bbox)
+{
+  //
+  // the template is built in the shared pyramid, the trackers do not allocate
+  // their own. The levels have the same sigmas for all the templates, but the
+  // number of levels may differ with the template size. The pyramid grows to
+  // the most levels
+  //
+  _trackers.push_back( bp::make_unique<Tracker>(_alg_params) );
+  _trackers.back()->setTemplate(I, bbox, _image_pyramid);
+  _results.resize(_trackers.size());
+
+  return size() - 1;
+}
+
+template <class M>
+const std::vector<Result>& MultiTemplateTracker<M>::track(const cv::Mat& I)
+{
+  if(_trackers.empty())
+    return _results;
+
+  _image_pyramid.setImage(I);
+
+  //
+  // compute the smoothed levels around all the templates first, the trackers
+  // then only read from the pyramid
+  //
+  for(const auto& t : _trackers)
+    t->prepare(_image_pyramid);
+
+  const int n = size();
+#if BITPLANES_WITH_TBB
+  tbb::parallel_for(0, n, [&](int i) {
+                    _results[i] = _trackers[i]->track(_image_pyramid); });
+#else
+#if BITPLANES_WITH_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(int i = 0; i < n; ++i)
+    _results[i] = _trackers[i]->track(_image_pyramid);
+#endif
+
+  _image_pyramid.releaseImage();
+  return _results;
+}
+
+template class MultiTemplateTracker<Homography>;
+template class MultiTemplateTracker<Affine>;
+template class MultiTemplateTracker<Translation>;
+
+}; // bp
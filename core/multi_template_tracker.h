@@ -0,0 +1,86 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_MULTI_TEMPLATE_TRACKER_H
+#define BITPLANES_CORE_MULTI_TEMPLATE_TRACKER_H
+
+#include "bitplanes/core/config.h"
+#include "bitplanes/core/bitplanes_tracker_pyramid.h"
+#include "bitplanes/core/internal/image_pyramid.h"
+#include "bitplanes/utils/memory.h"
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace bp {
+
+/**
+ * Tracks several templates in the same video.
+ *
+ * The image pyramid of each frame is computed once and shared by all the
+ * templates. It is computed only in the union of the regions around the
+ * templates, before the templates are tracked in parallel
+ */
+template <class M>
+class MultiTemplateTracker
+{
+  typedef BitPlanesTrackerPyramid<M> Tracker;
+
+ public:
+  typedef typename Tracker::Transform Transform;
+
+ public:
+  /**
+   * \param p algorithm parameters, used for all the templates
+   */
+  MultiTemplateTracker(const AlgorithmParameters& p = AlgorithmParameters())
+      : _alg_params(p) {}
+
+  /**
+   * Adds a template
+   *
+   * \param I reference image
+   * \param bbox template location
+   *
+   * \return the index of the template in the results of track()
+   */
+  int addTemplate(const cv::Mat& I, const cv::Rect& bbox);
+
+  /**
+   * \return the number of templates
+   */
+  inline int size() const { return static_cast<int>(_trackers.size()); }
+
+  /**
+   * Tracks all the templates, each is initialized with its previous pose
+   *
+   * \param I input image
+   * \return the result for each template, in the order they were added. The
+   * reference is valid until the next call to track
+   */
+  const std::vector<Result>& track(const cv::Mat& I);
+
+ private:
+  AlgorithmParameters _alg_params;
+  std::vector<UniquePointer<Tracker>> _trackers;
+  ImagePyramid _image_pyramid;   //< shared by all the templates
+  std::vector<Result> _results;
+}; // MultiTemplateTracker
+
+}; // bp
+
+#endif // BITPLANES_CORE_MULTI_TEMPLATE_TRACKER_H
@@ -0,0 +1,462 @@
+/*
+   This file is part of bitplanes.
+
+   bitplanes is free software: you can redistribute it and/or modify
+   it under the terms of the Lesser GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   bitplanes is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   Lesser GNU General Public License for more details.
+
+   You should have received a copy of the Lesser GNU General Public License
+   along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitplanes/core/template_model.h"
+#include "bitplanes/core/internal/optim_common.h"
+#include "bitplanes/core/internal/image_pyramid.h"
+#include "bitplanes/core/homography.h"
+#include "bitplanes/core/affine.h"
+#include "bitplanes/core/translation.h"
+#include "bitplanes/utils/error.h"
+#include "bitplanes/utils/timer.h"
+#include "bitplanes/utils/memory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace bp {
+
+cv::Rect TemplateFootprint(const cv::Rect& bbox, const Matrix33f& T,
+                           const cv::Size& image_size)
+{
+  const cv::Rect image_rect(cv::Point(0, 0), image_size);
+
+  //
+  // the ESM and FC linearizers warp the rows and columns around the template
+  // for the census gradients, the bbox grows by Ring template pixels before the
+  // warp. A margin in image pixels would not cover it once T magnifies
+  //
+  constexpr float Ring = 2.0f;
+
+  const float x0 = bbox.x - Ring, x1 = bbox.x + bbox.width - 1 + Ring,
+        y0 = bbox.y - Ring, y1 = bbox.y + bbox.height - 1 + Ring;
+  const Vector3f corners[4] = {
+    T * Vector3f(x0, y0, 1.0f), T * Vector3f(x1, y0, 1.0f),
+    T * Vector3f(x0, y1, 1.0f), T * Vector3f(x1, y1, 1.0f) };
+
+  float x_min = std::numeric_limits<float>::max(), x_max = -x_min,
+        y_min = x_min, y_max = -x_min;
+  for(const auto& p : corners)
+  {
+    // degenerate warp, the template is not bounded in the image
+    if(p[2] <= 0.0f)
+      return image_rect;
+
+    const float x = p[0] / p[2], y = p[1] / p[2];
+    x_min = std::min(x_min, x); x_max = std::max(x_max, x);
+    y_min = std::min(y_min, y); y_max = std::max(y_max, y);
+  }
+
+  // one pixel for the bilinear interpolation and one for the rounding of the
+  // fixed-point warp
+  constexpr float Margin = 2.0f;
+
+  x_min = std::max(x_min - Margin, 0.0f);
+  y_min = std::max(y_min - Margin, 0.0f);
+  x_max = std::min(x_max + Margin, static_cast<float>(image_size.width - 1));
+  y_max = std::min(y_max + Margin, static_cast<float>(image_size.height - 1));
+  if(x_min > x_max || y_min > y_max)
+    return cv::Rect();
+
+  const int xs = static_cast<int>(std::floor(x_min)),
+        ys = static_cast<int>(std::floor(y_min));
+  return cv::Rect(xs, ys, static_cast<int>(std::ceil(x_max)) - xs + 1,
+                  static_cast<int>(std::ceil(y_max)) - ys + 1) & image_rect;
+}
+
+namespace {
+
+template <class M> inline AlgorithmParameters::MotionType MotionTypeOf();
+
+template <> inline AlgorithmParameters::MotionType MotionTypeOf<Homography>()
+{
+  return AlgorithmParameters::MotionType::Homography;
+}
+
+template <> inline AlgorithmParameters::MotionType MotionTypeOf<Affine>()
+{
+  return AlgorithmParameters::MotionType::Affine;
+}
+
+template <> inline AlgorithmParameters::MotionType MotionTypeOf<Translation>()
+{
+  return AlgorithmParameters::MotionType::Translation;
+}
+
+} // namespace
+
+template <class M>
+TemplateModel<M>::TemplateModel(const AlgorithmParameters& p, const cv::Mat& I,
+                                const cv::Rect& bbox)
+  : _alg_params(p)
+  , _cdata(p.subsampling,
+           p.template_storage == AlgorithmParameters::TemplateStorage::Compact ||
+           p.linearizer == AlgorithmParameters::LinearizerType::ESM,
+           p.max_template_pixels)
+  , _bbox(bbox)
+  , _T(Matrix33f::Identity()), _T_inv(Matrix33f::Identity())
+{
+  THROW_ERROR_IF( !isFC() && p.template_storage == AlgorithmParameters::TemplateStorage::Census,
+                  "the census storage can only be tracked with FC" );
+
+  _alg_params.motion_type = MotionTypeOf<M>();
+
+  // ESM uses the gradient codes of the compact storage, not the Jacobian
+  if(isESM())
+    _alg_params.template_storage = AlgorithmParameters::TemplateStorage::Compact;
+
+  _cdata.getCoordinateNormalization(bbox, _T, _T_inv);
+
+  // FC needs only the census of the template, there is nothing to factorize
+  if(isFC()) {
+    _alg_params.template_storage = AlgorithmParameters::TemplateStorage::Census;
+    _cdata.setCensus(I, bbox, _T(0,0), _T_inv(0,2), _T_inv(1,2));
+    return;
+  }
+
+  _cdata.set(I, bbox, _T(0,0), _T_inv(0,2), _T_inv(1,2));
+  _solver.compute(-_cdata.hessian());
+}
+
+template <class M>
+auto TemplateModel<M>::Create(const cv::Mat& I, const cv::Rect& bbox,
+                              const AlgorithmParameters& p) -> Pointer
+{
+  TrackingWorkspace<M> workspace;
+  workspace.smoothImage(I, TemplateFootprint(bbox, Transform::Identity(), I.size()),
+                        p.sigma);
+
+  // 'new' uses the aligned operator new of the class
+  return Pointer(new TemplateModel(p, workspace.image(), bbox));
+}
+
+namespace {
+
+/**
+ * The fixed-size part of the model in the binary file. These are the
+ * parameters that were used to build the model, and those of the tracking
+ */
+struct ModelHeader
+{
+  int32_t subsampling;
+  int32_t template_storage;
+  int32_t max_template_pixels;
+  int32_t max_iterations;
+  float parameter_tolerance;
+  float function_tolerance;
+  float sigma;
+  int32_t bbox[4];
+  float T[9], T_inv[9];
+}; // ModelHeader
+
+} // namespace
+
+template <class M>
+void TemplateModel<M>::write(BinaryWriter& writer) const
+{
+  ModelHeader h;
+  std::memset(&h, 0, sizeof(h));
+  h.subsampling = _alg_params.subsampling;
+  h.template_storage = static_cast<int32_t>(_alg_params.template_storage);
+  h.max_template_pixels = _alg_params.max_template_pixels;
+  h.max_iterations = _alg_params.max_iterations;
+  h.parameter_tolerance = _alg_params.parameter_tolerance;
+  h.function_tolerance = _alg_params.function_tolerance;
+  h.sigma = _alg_params.sigma;
+  h.bbox[0] = _bbox.x; h.bbox[1] = _bbox.y;
+  h.bbox[2] = _bbox.width; h.bbox[3] = _bbox.height;
+  std::memcpy(h.T, _T.data(), sizeof(h.T));
+  std::memcpy(h.T_inv, _T_inv.data(), sizeof(h.T_inv));
+
+  writer.write(h);
+  _cdata.write(writer);
+}
+
+template <class M>
+auto TemplateModel<M>::Read(BinaryReader& reader, const AlgorithmParameters& p)
+    -> Pointer
+{
+  const auto h = reader.read<ModelHeader>();
+
+  // 'new' uses the aligned operator new of the class
+  SharedPointer<TemplateModel> ret(new TemplateModel());
+  ret->_alg_params = p;
+  ret->_alg_params.motion_type = MotionTypeOf<M>();
+  ret->_alg_params.subsampling = h.subsampling;
+  ret->_alg_params.template_storage =
+      static_cast<AlgorithmParameters::TemplateStorage>(h.template_storage);
+  ret->_alg_params.max_template_pixels = h.max_template_pixels;
+  ret->_alg_params.max_iterations = h.max_iterations;
+  ret->_alg_params.parameter_tolerance = h.parameter_tolerance;
+  ret->_alg_params.function_tolerance = h.function_tolerance;
+  ret->_alg_params.sigma = h.sigma;
+  ret->_bbox = cv::Rect(h.bbox[0], h.bbox[1], h.bbox[2], h.bbox[3]);
+  std::memcpy(ret->_T.data(), h.T, sizeof(h.T));
+  std::memcpy(ret->_T_inv.data(), h.T_inv, sizeof(h.T_inv));
+
+  ret->_cdata.read(reader);
+  THROW_ERROR_IF( ret->isESM() && (!ret->_cdata.isCompact() || ret->_cdata.isCensusOnly()),
+                  "ESM needs a template with compact storage" );
+  THROW_ERROR_IF( ret->isFC() && !ret->_cdata.isCompact(),
+                  "FC needs a template with compact or census storage" );
+  THROW_ERROR_IF( !ret->isFC() && ret->_cdata.isCensusOnly(),
+                  "the census storage can only be tracked with FC" );
+
+  // factorizing the DOF x DOF Hessian is cheaper than storing Eigen's internals
+  if(ret->_alg_params.linearizer == AlgorithmParameters::LinearizerType::InverseCompositional)
+    ret->_solver.compute(-ret->_cdata.hessian());
+  return ret;
+}
+
+template <class M>
+void TrackingWorkspace<M>::reserve(const ModelType& model, const cv::Size& image_size)
+{
+  if(_I.size() != image_size) {
+    RecordAllocation();
+    _I.create(image_size, CV_8UC1);
+  }
+
+  if(!_image_pyramid)
+    initFilter(image_size, model.parameters().sigma);
+
+  _scratch.reserve(model.channelData().workspaceSize());
+}
+
+template <class M>
+void TrackingWorkspace<M>::initFilter(const cv::Size& image_size, float sigma)
+{
+  if(_filter.numLevels() != 1 || _filter.size() != image_size ||
+     _filter.sigmas()[0] != sigma) {
+    RecordAllocation();
+    _filter.init(image_size, std::vector<float>(1, sigma));
+  }
+}
+
+template <class M>
+void TrackingWorkspace<M>::smoothImage(const cv::Mat& src, const cv::Rect& roi,
+                                       float sigma)
+{
+  if(_I.size() != src.size() || _I.type() != src.type()) {
+    RecordAllocation();
+    _I.create(src.size(), src.type());
+    _smoothed_roi = cv::Rect();
+  }
+
+  if((roi & _smoothed_roi) == roi)
+    return;
+
+  const cv::Rect box = _smoothed_roi.area() ? (roi | _smoothed_roi) : roi;
+
+  //
+  // the filter reads the pixels around 'box' from the whole image, hence the
+  // result in 'box' is the same as smoothing the whole image. Without a
+  // pyramid, we smooth with the level 0 of our own, its buffers are reused
+  //
+  if(_image_pyramid) {
+    _image_pyramid->smooth(_pyramid_level, box, _I);
+  } else {
+    initFilter(src.size(), sigma);
+    _filter.setImage(src);
+    _filter.smooth(0, box, _I);
+    _filter.releaseImage();
+  }
+
+  _smoothed_roi = box;
+}
+
+template <class M>
+Result track(const TemplateModel<M>& model, TrackingWorkspace<M>& workspace,
+             const cv::Mat& image, const Matrix33f& T_init, float time_budget_ms)
+{
+  typedef typename TemplateModel<M>::MotionModelType MotionModelType;
+  typedef typename TemplateModel<M>::ParameterVector ParameterVector;
+  typedef std::chrono::steady_clock Clock;
+
+  Result ret(T_init);
+  Timer timer;
+
+  //
+  // the deadline does not use Timer, which counts whole milliseconds and may
+  // be compiled out (BITPLANES_WITH_TIMING)
+  //
+  const bool has_budget = time_budget_ms > 0.0f;
+  const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<float, std::milli>(std::max(time_budget_ms, 0.0f)));
+
+  const auto& alg_params = model.parameters();
+  auto& gradient = workspace.gradient();
+  auto& hessian = workspace.hessian();
+
+  //
+  // smooth only the part of the image under the warped template. If the
+  // iterations move the template outside the smoothed region, it grows
+  //
+  workspace.resetImage();
+  workspace.smoothImage(image, model.footprint(ret.T, image.size()), alg_params.sigma);
+
+  float sum_sq = model.linearize(workspace.image(), ret.T, gradient, hessian,
+                                 workspace.scratch());
+  float g_norm = gradient.template lpNorm<Eigen::Infinity>();
+
+  const auto p_tol = alg_params.parameter_tolerance,
+        f_tol = alg_params.function_tolerance,
+        sqrt_eps = std::sqrt(std::numeric_limits<float>::epsilon()),
+        tol_opt = 1e-4f * f_tol, rel_factor = std::max(sqrt_eps, g_norm);
+
+  const auto max_iters = alg_params.max_iterations;
+  const auto verbose = alg_params.verbose;
+  const bool stop_on_increase = model.isESM() || model.isFC();
+
+  if(verbose) {
+    printf("\n                                        First-Order         Norm of \n"
+           " Iteration  Func-count    Residual       optimality            step\n");
+    printf(" %5d       %5d   %13.6g    %12.3g\n", 0, 1, sum_sq, g_norm);
+  }
+
+  if(g_norm < tol_opt*rel_factor) {
+    if(verbose)
+      printf("initial value is optimal %g < %g\n", g_norm, tol_opt*rel_factor);
+
+    ret.final_ssd_error = sum_sq;
+    ret.first_order_optimality = g_norm;
+    ret.time_ms = timer.stop().count();
+    ret.num_iterations = 1;
+    ret.status = OptimizerStatus::FirstOrderOptimality;
+    return ret;
+  }
+
+  //
+  // the evaluated transform with the lowest residual, returned if the budget
+  // runs out. The residuals sum over all the template pixels, the pixels
+  // warped outside the image read as zero (see warpImage), hence they compare
+  // without a normalization. The limitation is that a pose that moves the
+  // template off the image is compared on zeros for the part that is out
+  //
+  Matrix33f best_T = ret.T;
+  float best_sum_sq = sum_sq;
+
+  float old_sum_sq = std::numeric_limits<float>::max();
+  bool has_converged = false;
+  int it = 1;
+  while(!has_converged && it++ < max_iters)
+  {
+    //
+    // the first update is always made, a budget smaller than an iteration
+    // would otherwise return T_init, which is of no use to the next pyramid
+    // level
+    //
+    if(has_budget && it > 2 && Clock::now() >= deadline) {
+      if(verbose)
+        printf("Time budget of %g ms exceeded\n", time_budget_ms);
+
+      ret.status = OptimizerStatus::TimeBudgetExceeded;
+      ret.T = best_T;
+      old_sum_sq = best_sum_sq;
+      break;
+    }
+
+    const ParameterVector dp = model.solve(gradient, hessian);
+    {
+      const auto dp_norm = dp.norm();
+      const auto p_norm = MotionModelType::ParamsNorm(ret.T);
+
+      if(verbose) {
+        printf(" %5d       %5d   %13.6g    %12.3g    %12.6g\n",
+               it, 1 + it, sum_sq, g_norm, dp_norm);
+      }
+
+      has_converged = TestConverged(dp_norm, p_norm, p_tol,
+                                    g_norm, tol_opt, rel_factor,
+                                    sum_sq, old_sum_sq, f_tol,
+                                    sqrt_eps, it, max_iters, verbose,
+                                    ret.status);
+
+      //
+      // ESM and FC linearize at T, a full step that increases the residual
+      // means the iterations are down to the noise of the census bits. We stop
+      // at the best transform instead of wandering until max_iterations
+      //
+      if(!has_converged && stop_on_increase && sum_sq > old_sum_sq) {
+        if(verbose)
+          printf("No reduction in error [%g > %g]\n", sum_sq, old_sum_sq);
+
+        ret.status = OptimizerStatus::SmallRelativeReduction;
+        ret.T = best_T;
+        old_sum_sq = best_sum_sq;
+        break;
+      }
+
+      old_sum_sq = sum_sq;
+    }
+
+    ret.T = model.update(ret.T, dp);
+
+    if(!has_converged) {
+      workspace.smoothImage(image, model.footprint(ret.T, image.size()), alg_params.sigma);
+      sum_sq = model.linearize(workspace.image(), ret.T, gradient, hessian,
+                               workspace.scratch());
+      g_norm = gradient.template lpNorm<Eigen::Infinity>();
+
+      if(sum_sq < best_sum_sq) {
+        best_sum_sq = sum_sq;
+        best_T = ret.T;
+      }
+    }
+  }
+
+  ret.time_ms = timer.stop().count();
+  ret.num_iterations = it;
+  ret.final_ssd_error = old_sum_sq;
+  ret.first_order_optimality = g_norm;
+  if(ret.status == OptimizerStatus::NotStarted) {
+    ret.status = OptimizerStatus::MaxIterations;
+    if(verbose) {
+      std::cout << "Max iterations reached\n";
+    }
+  }
+
+  if(verbose) {
+    printf("\n\n");
+  }
+
+  return ret;
+}
+
+template class TemplateModel<Homography>;
+template class TrackingWorkspace<Homography>;
+template Result track<Homography>(const TemplateModel<Homography>&,
+                                  TrackingWorkspace<Homography>&,
+                                  const cv::Mat&, const Matrix33f&, float);
+
+template class TemplateModel<Affine>;
+template class TrackingWorkspace<Affine>;
+template Result track<Affine>(const TemplateModel<Affine>&,
+                              TrackingWorkspace<Affine>&,
+                              const cv::Mat&, const Matrix33f&, float);
+
+template class TemplateModel<Translation>;
+template class TrackingWorkspace<Translation>;
+template Result track<Translation>(const TemplateModel<Translation>&,
+                                   TrackingWorkspace<Translation>&,
+                                   const cv::Mat&, const Matrix33f&, float);
+
+}; // bp
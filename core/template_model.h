@@ -0,0 +1,266 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_CORE_TEMPLATE_MODEL_H
+#define BITPLANES_CORE_TEMPLATE_MODEL_H
+
+#include "bitplanes/core/config.h"
+#include "bitplanes/core/types.h"
+#include "bitplanes/core/algorithm_parameters.h"
+#include "bitplanes/core/motion_model.h"
+#include "bitplanes/core/internal/bitplanes_channel_data_subsampled.h"
+#include "bitplanes/core/internal/image_pyramid.h"
+#include "bitplanes/utils/memory.h"
+
+#include <opencv2/core.hpp>
+
+#include <Eigen/Cholesky>
+
+namespace bp {
+
+/**
+ * \return the bounding box of 'bbox' warped with T, with a ring of template
+ * pixels for the census gradients of ESM and FC, and a margin for the bilinear
+ * interpolation. The box is clipped to the image
+ */
+cv::Rect TemplateFootprint(const cv::Rect& bbox, const Matrix33f& T,
+                           const cv::Size& image_size);
+
+/**
+ * The template data that does not change while tracking: the descriptors, the
+ * Jacobian and the factorized Hessian (only the descriptors with FC).
+ *
+ * The model is immutable once constructed, hence it can be shared (see
+ * Pointer) by several threads, each tracking with its own TrackingWorkspace
+ */
+template <class M>
+class TemplateModel
+{
+ public:
+  typedef Matrix33f       Transform;
+  typedef MotionModel<M>  MotionModelType;
+
+  typedef typename MotionModelType::Hessian         Hessian;
+  typedef typename MotionModelType::Gradient        Gradient;
+  typedef typename MotionModelType::ParameterVector ParameterVector;
+
+  typedef typename Eigen::LDLT<Hessian> Solver;
+
+  typedef BitPlanesChannelDataSubSampled<M> ChannelDataType;
+
+  typedef SharedPointer<const TemplateModel> Pointer;
+
+ public:
+  /**
+   * \param p algorithm parameters
+   * \param I the template image, already smoothed with p.sigma around bbox
+   * \param bbox location of the template in I
+   */
+  TemplateModel(const AlgorithmParameters& p, const cv::Mat& I, const cv::Rect& bbox);
+
+  /**
+   * Smooths the image around the template and creates the model
+   *
+   * \param I the template image
+   * \param bbox location of the template in I
+   * \param p algorithm parameters
+   */
+  static Pointer Create(const cv::Mat& I, const cv::Rect& bbox,
+                        const AlgorithmParameters& p = AlgorithmParameters());
+
+  /**
+   * Writes the model to a binary file (see BinaryWriter)
+   */
+  void write(BinaryWriter&) const;
+
+  /**
+   * Reads a model written with write(). The arrays are not recomputed, and the
+   * Jacobian matrix is used in place from the file
+   *
+   * \param p parameters for the settings that are not stored with the model,
+   * e.g. verbose
+   */
+  static Pointer Read(BinaryReader&, const AlgorithmParameters& p = AlgorithmParameters());
+
+  inline const AlgorithmParameters& parameters() const { return _alg_params; }
+  inline const ChannelDataType& channelData() const { return _cdata; }
+  inline const cv::Rect& bbox() const { return _bbox; }
+
+  /**
+   * \return the region of the image that the template warped with T needs
+   */
+  inline cv::Rect footprint(const Transform& T, const cv::Size& image_size) const
+  {
+    return TemplateFootprint(_bbox, T, image_size);
+  }
+
+  /**
+   * Linearizes the cost function at T (see ChannelDataType::linearize). With
+   * the ESM and FC linearizers, H is set to the Hessian at T, otherwise it is
+   * not used
+   *
+   * \return the sum of squared residuals
+   */
+  inline float linearize(const cv::Mat& I, const Transform& T, Gradient& g,
+                         Hessian& H, Arena& workspace) const
+  {
+    return isESM() ? _cdata.linearizeESM(I, T, g, H, workspace) :
+        isFC() ? _cdata.linearizeFC(I, T, g, H, workspace) :
+        _cdata.linearize(I, T, g, workspace);
+  }
+
+  /**
+   * \return the parameters of the step for the gradient 'g'. With the ESM and
+   * FC linearizers, H is the Hessian from linearize(), otherwise the template
+   * Hessian is used
+   */
+  inline ParameterVector solve(const Gradient& g, const Hessian& H) const
+  {
+    return (isESM() || isFC()) ? Solver(-H).solve(g) : _solver.solve(g);
+  }
+
+  inline bool isESM() const
+  {
+    return _alg_params.linearizer == AlgorithmParameters::LinearizerType::ESM;
+  }
+
+  inline bool isFC() const
+  {
+    return _alg_params.linearizer == AlgorithmParameters::LinearizerType::ForwardCompositional;
+  }
+
+  /**
+   * \return T updated with the step 'dp'. The ESM and FC steps are in the
+   * template coordinates and compose on the right, T <- T * W(dp)
+   */
+  inline Transform update(const Transform& T, const ParameterVector& dp) const
+  {
+    const Transform W = _T_inv * MotionModelType::ParamsToMatrix(dp) * _T;
+    return (isESM() || isFC()) ? Transform(T * W) : Transform(W * T);
+  }
+
+ private:
+  TemplateModel() = default;
+
+ private:
+  AlgorithmParameters _alg_params; //< AlgorithmParameters
+  ChannelDataType _cdata;          //< holds the multi-channel data
+  cv::Rect _bbox;                  //< the template's bounding box
+  Matrix33f _T, _T_inv;            //< normalization matrices
+  Solver _solver;                  //< the linear solver
+
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+}; // TemplateModel
+
+/**
+ * The buffers that change while tracking a template. A workspace is used by a
+ * single thread at a time, and can track any template
+ */
+template <class M>
+class TrackingWorkspace
+{
+ public:
+  typedef TemplateModel<M> ModelType;
+  typedef typename ModelType::Gradient Gradient;
+  typedef typename ModelType::Hessian Hessian;
+
+ public:
+  TrackingWorkspace() = default;
+
+  /**
+   * Allocates the buffers for the model, so that tracking images of size
+   * 'image_size' does not allocate. Without an image pyramid (see
+   * setImagePyramid), this includes the filter of the smoothing
+   */
+  void reserve(const ModelType& model, const cv::Size& image_size);
+
+  /**
+   * Uses the level 'level' of 'pyr' as the pre-smoothed image. The pyramid
+   * computes the smoothed image in the regions we need, and the input images
+   * are only used for their size.
+   *
+   * The pyramid must outlive the workspace, or be unset with a nullptr
+   */
+  inline void setImagePyramid(ImagePyramid* pyr, int level = 0)
+  {
+    _image_pyramid = pyr;
+    _pyramid_level = level;
+  }
+
+  /**
+   * Marks the smoothed image as invalid, call before using a new input
+   */
+  inline void resetImage() { _smoothed_roi = cv::Rect(); }
+
+  /**
+   * applies smoothing to the image at the specified ROI. The output is written
+   * to image(), which is reused between calls if the image size does not
+   * change.
+   *
+   * Only the ROI is smoothed. If part of it was already smoothed for the same
+   * input (see resetImage), the smoothed region grows to the union of the two
+   */
+  void smoothImage(const cv::Mat& src, const cv::Rect& roi, float sigma);
+
+  inline const cv::Mat& image() const { return _I; }
+  inline Arena& scratch() { return _scratch; }
+  inline Gradient& gradient() { return _gradient; }
+  inline Hessian& hessian() { return _hessian; }
+
+ private:
+  /**
+   * sets up _filter to smooth images of size 'image_size' with 'sigma'
+   */
+  void initFilter(const cv::Size& image_size, float sigma);
+
+ private:
+  cv::Mat _I;                      //< buffer for the smoothed input image
+  cv::Rect _smoothed_roi;          //< region of _I that holds the smoothed input
+  ImagePyramid* _image_pyramid = nullptr; //< source of the smoothed image
+  ImagePyramid _filter;            //< smooths the image without _image_pyramid
+  int _pyramid_level = 0;          //< level of the image in _image_pyramid
+  Arena _scratch;                  //< scratch buffers of the linearization
+  Gradient _gradient;              //< gradient of the cost function
+  Hessian _hessian;                //< Hessian of the cost function (ESM, FC)
+
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+}; // TrackingWorkspace
+
+/**
+ * Tracks the template 'model' in 'frame'
+ *
+ * This is safe to call concurrently for the same model, as long as every
+ * thread uses its own workspace
+ *
+ * \param model the template
+ * \param workspace buffers used while tracking
+ * \param frame the input image
+ * \param T_init initialization of the transform
+ * \param time_budget_ms stop after this many milliseconds and return the
+ * transform with the lowest residual so far (TimeBudgetExceeded). The first
+ * update is always made. A value <= 0 means no limit
+ */
+template <class M>
+Result track(const TemplateModel<M>& model, TrackingWorkspace<M>& workspace,
+             const cv::Mat& frame, const Matrix33f& T_init = Matrix33f::Identity(),
+             float time_budget_ms = -1.0f);
+
+}; // bp
+
+#endif // BITPLANES_CORE_TEMPLATE_MODEL_H
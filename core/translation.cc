@@ -24,7 +24,12 @@ namespace bp {
 
 auto Translation::Scale(const Transform& T, float scale) -> Transform
 {
-  return T * scale;
+  Transform S(T);
+
+  S(0,2) *= scale;
+  S(1,2) *= scale;
+
+  return S;
 }
 
 auto Translation::MatrixToParams(const Transform& H) -> ParameterVector
@@ -48,15 +53,6 @@ auto Translation::Solve(const Hessian& A, const Gradient& b) -> ParameterVector
   return -A.ldlt().solve(b);
 }
 
-auto Translation::ComputeWarpJacobian(float /*x*/, float /*y*/, float /*s*/,
-                                      float /*c1*/, float /*c2*/) -> WarpJacobian
-{
-  WarpJacobian Jw;
-  Jw << 1.0, 1.0f;
-  return Jw;
-}
-
-
 } // bp
 
 
@@ -52,6 +52,14 @@ class Translation : public MotionModel<Translation>
    */
   static ParameterVector MatrixToParams(const Transform&);
 
+  /**
+   * \return the norm of the parameters of the matrix
+   */
+  static inline float ParamsNorm(const Transform& T)
+  {
+    return MatrixToParams(T).norm();
+  }
+
   /**
    * solve the linear system
    */
@@ -73,8 +81,8 @@ class Translation : public MotionModel<Translation>
     J[1] = Iy;
   }
 
-  static WarpJacobian ComputeWarpJacobian(float x, float y, float s = 1.0,
-                                          float c1 = 0.0, float c2 = 0.0);
+  static inline WarpJacobian ComputeWarpJacobian(float x, float y, float s = 1.0,
+                                                 float c1 = 0.0, float c2 = 0.0);
 
   static inline void ComputeWarpJacobian(Eigen::Ref<WarpJacobian> Jw, float x, float y,
                                          float s = 1.0f, float c1 = 0.0f, float c2 = 0.0f)
@@ -83,6 +91,17 @@ class Translation : public MotionModel<Translation>
   }
 }; // Translation
 
+inline auto Translation::ComputeWarpJacobian(float /*x*/, float /*y*/, float s,
+                                             float /*c1*/, float /*c2*/) -> WarpJacobian
+{
+  WarpJacobian Jw;
+  Jw <<
+      1.0f/s, 0.0f,
+      0.0f, 1.0f/s;
+
+  return Jw;
+}
+
 }; // bp
 
 #endif // BITPLANES_CORE_TRANSLATION_H
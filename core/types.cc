@@ -46,6 +46,9 @@ std::string ToString(OptimizerStatus status)
     case OptimizerStatus::SmallAbsParameters:
       s = "SmallAbsParameters";
       break;
+    case OptimizerStatus::TimeBudgetExceeded:
+      s = "TimeBudgetExceeded";
+      break;
   }
 
   return s;
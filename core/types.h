@@ -72,6 +72,7 @@ enum class OptimizerStatus
   SmallAbsError,          //< absolute error value is small
   SmallParameterUpdate,   //< current delta parameters is small
   SmallAbsParameters,     //< absolute parameter step is small
+  TimeBudgetExceeded,     //< the time budget ran out before convergence
 }; // OptimizerStatus
 
 /**
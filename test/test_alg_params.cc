@@ -16,8 +16,10 @@
 */
 
 #include <bitplanes/core/algorithm_parameters.h>
+#include <bitplanes/core/bitplanes_tracker_pyramid.h>
 #include <bitplanes/core/config.h>
 
+#include <fstream>
 #include <iostream>
 
 using namespace bp;
@@ -30,7 +32,40 @@ int main()
   std::cout << params << std::endl;
 
   params.save("/tmp/test.cfg");
-  return 0;
+
+  int n_failed = 0;
+
+  {
+    std::ofstream ofs("/tmp/test_schedule.cfg");
+    ofs << "MotionSchedule = Translation, Affine\n";
+    ofs.close();
+
+    AlgorithmParameters p;
+    if(!p.load("/tmp/test_schedule.cfg") || p.motion_schedule.size() != 2 ||
+       p.motion_schedule[0] != AlgorithmParameters::MotionType::Translation ||
+       p.motion_schedule[1] != AlgorithmParameters::MotionType::Affine) {
+      std::cerr << "bad motion schedule\n";
+      ++n_failed;
+    }
+  }
+
+  {
+    AlgorithmParameters p;
+    for(float motion : {1.0f, 8.0f, 32.0f})
+    {
+      p.expected_motion = motion;
+      for(int w : {50, 100, 300, 640})
+        printf("template %3dx%-3d motion %4.1f: %d levels\n", w, w, motion,
+               AutoPyramidLevels(cv::Size(w, w), p));
+    }
+  }
+
+  if(n_failed)
+    std::cerr << n_failed << " tests failed\n";
+  else
+    std::cout << "all good\n";
+
+  return n_failed != 0;
 }
 
 
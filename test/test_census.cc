@@ -0,0 +1,100 @@
+#include "bitplanes/core/cpu.h"
+#include "bitplanes/core/internal/ct.h"
+#include "bitplanes/utils/timer.h"
+
+#include <opencv2/core.hpp>
+
+#include <iostream>
+
+/**
+ * scalar reference implementation
+ */
+static void census_ref(const cv::Mat& src, const cv::Rect& roi, cv::Mat& dst)
+{
+  dst.create(roi.size(), CV_8UC1);
+  const int s = src.cols;
+  for(int y = 0; y < roi.height; ++y)
+    for(int x = 0; x < roi.width; ++x)
+    {
+      const uint8_t* p = src.ptr<const uint8_t>(y + roi.y) + x + roi.x;
+      dst.at<uint8_t>(y, x) =
+          ((*(p - s - 1) >= *p) << 0) | ((*(p - s) >= *p) << 1) |
+          ((*(p - s + 1) >= *p) << 2) | ((*(p - 1) >= *p) << 3) |
+          ((*(p + 1) >= *p) << 4)     | ((*(p + s - 1) >= *p) << 5) |
+          ((*(p + s) >= *p) << 6)     | ((*(p + s + 1) >= *p) << 7);
+    }
+}
+
+static int count_diff(const cv::Mat& a, const cv::Mat& b)
+{
+  int ret = 0;
+  for(int y = 0; y < a.rows; ++y)
+    for(int x = 0; x < a.cols; ++x)
+      ret += a.at<uint8_t>(y, x) != b.at<uint8_t>(y, x);
+  return ret;
+}
+
+int main()
+{
+  cv::Mat I(480, 640, CV_8UC1);
+  cv::randu(I, cv::Scalar(0), cv::Scalar(256));
+
+  // add some flat areas to exercise equal values
+  I(cv::Rect(100, 100, 50, 50)).setTo(cv::Scalar(128));
+
+  const cv::Rect rois[] = {
+    cv::Rect(1, 1, 638, 478),     // whole image
+    cv::Rect(10, 20, 17, 5),      // not a multiple of the vector width
+    cv::Rect(37, 11, 100, 60),
+    cv::Rect(600, 400, 39, 79),   // touching the right border
+    cv::Rect(90, 90, 80, 80),     // flat area
+    cv::Rect(5, 5, 3, 3)
+  };
+
+  const bp::SimdLevel levels[] = {
+    bp::SimdLevel::Scalar, bp::SimdLevel::SSE2, bp::SimdLevel::AVX2,
+    bp::SimdLevel::AVX512
+  };
+
+  int n_failed = 0;
+  for(auto level : levels)
+  {
+    if(bp::SetSimdLevel(level) != level) {
+      printf("%s is not supported\n", bp::ToString(level).c_str());
+      continue;
+    }
+
+    for(const auto& roi : rois)
+    {
+      cv::Mat C0, C1;
+      census_ref(I, roi, C0);
+      bp::simd::census(I, roi, C1);
+
+      const int n_diff = count_diff(C0, C1);
+      if(n_diff) {
+        std::cerr << bp::ToString(level) << ": census mismatch at " << roi
+            << " " << n_diff << " pixels\n";
+        ++n_failed;
+      }
+    }
+
+    cv::Mat C;
+    const cv::Rect roi(1, 1, 638, 478);
+    auto t_ms = bp::TimeCode(100, [&]() { bp::simd::census(I, roi, C); });
+    printf("census time [%s] %0.3f ms\n", bp::ToString(level).c_str(), t_ms);
+  }
+
+  {
+    cv::Mat C;
+    const cv::Rect roi(1, 1, 638, 478);
+    auto t_ms = bp::TimeCode(100, [&]() { census_ref(I, roi, C); });
+    printf("census time [reference] %0.3f ms\n", t_ms);
+  }
+
+  if(n_failed)
+    std::cerr << n_failed << " tests failed\n";
+  else
+    std::cout << "all good\n";
+
+  return n_failed != 0;
+}
@@ -0,0 +1,234 @@
+#include <bitplanes/core/bitplanes_tracker.h>
+#include <bitplanes/core/bitplanes_tracker_pyramid.h>
+#include <bitplanes/core/internal/bitplanes_channel_data_subsampled.h>
+#include <bitplanes/core/homography.h>
+#include <bitplanes/utils/memory.h>
+#include <bitplanes/test/test_utils.h>
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+using namespace bp;
+
+typedef BitPlanesChannelDataSubSampled<Homography> ChannelData;
+
+static inline uint8_t CensusAt(const cv::Mat& I, int y, int x)
+{
+  const uint8_t v = I.at<uint8_t>(y, x);
+  uint8_t ret = 0;
+  for(int dy = -1, b = 0; dy <= 1; ++dy)
+    for(int dx = -1; dx <= 1; ++dx)
+      if(dx || dy)
+        ret |= (I.at<uint8_t>(y + dy, x + dx) >= v) << b++;
+  return ret;
+}
+
+static inline float Bit(uint8_t c, int b) { return static_cast<float>((c >> b) & 1); }
+
+/**
+ * ESM (or FC if 'esm' is false) gradient and Hessian computed from the warped
+ * image, one Jacobian row per channel
+ */
+static float LinearizeReference(const ChannelData& cdata, const cv::Mat& I,
+                                const Matrix33f& T, const cv::Rect& roi, bool esm,
+                                ChannelData::Gradient& g, ChannelData::Hessian& H)
+{
+  // two pixels of margin for the census of the neighbors
+  const cv::Rect roi_e(roi.x - 2, roi.y - 2, roi.width + 4, roi.height + 4);
+  cv::Mat Iw;
+  ChannelData tmp;
+  tmp.warpImage(I, T, roi_e, Iw);
+
+  g.setZero();
+  H.setZero();
+  float sum_sq = 0.0f;
+
+  const auto& codes = cdata.gradientCodes();
+  for(const auto& r : cdata.pixelRows())
+  {
+    for(int j = r.begin; j < r.end; ++j)
+    {
+      const int x = cdata.pixelCols()[j] + 2, y = r.y + 2;
+      const uint8_t w = CensusAt(Iw, y, x), c = cdata.pixels()[j],
+            wl = CensusAt(Iw, y, x-1), wr = CensusAt(Iw, y, x+1),
+            wu = CensusAt(Iw, y-1, x), wd = CensusAt(Iw, y+1, x);
+
+      const auto Jw = Homography::ComputeWarpJacobian(x - 2 + roi.x, r.y + roi.y, 1, 0, 0);
+      for(int b = 0; b < 8; ++b)
+      {
+        const float ix = 0.5f * (Bit(wr, b) - Bit(wl, b)),
+              iy = 0.5f * (Bit(wd, b) - Bit(wu, b));
+
+        Eigen::Matrix<float, 1, 8> J = Eigen::Matrix<float, 1, 2>(ix, iy) * Jw;
+        if(esm) {
+          const float tx = 0.5f * (Bit(codes[j].gx_pos, b) - Bit(codes[j].gx_neg, b)),
+                ty = 0.5f * (Bit(codes[j].gy_pos, b) - Bit(codes[j].gy_neg, b));
+          J = 0.5f * (J + Eigen::Matrix<float, 1, 2>(tx, ty) * Jw);
+        }
+        const float res = Bit(w, b) - Bit(c, b);
+
+        H.noalias() += J.transpose() * J;
+        g.noalias() += J.transpose() * res;
+        sum_sq += res * res;
+      }
+    }
+  }
+
+  return sum_sq;
+}
+
+int main()
+{
+  const cv::Mat I0 = MakeSyntheticFrame();
+
+  int n_failed = 0;
+
+  //
+  // the fused ESM and FC linearizations against the reference
+  //
+  {
+    const cv::Rect roi(100, 80, 256, 200);
+    Matrix33f T(Matrix33f::Identity());
+    T(0,0) = 1.01f; T(0,1) = 0.02f; T(0,2) = 2.5f;
+    T(1,2) = -1.5f; T(2,0) = 1e-5f;
+
+    for(bool esm : {true, false})
+    {
+      for(int s : {1, 2})
+      {
+        ChannelData cdata(s, true);
+        if(esm)
+          cdata.set(I0, roi);
+        else
+          cdata.setCensus(I0, roi);
+
+        Arena workspace(cdata.workspaceSize());
+        ChannelData::Gradient g0, g1;
+        ChannelData::Hessian H0, H1;
+        const float ssd0 = LinearizeReference(cdata, I0, T, roi, esm, g0, H0);
+        const float ssd1 = esm ? cdata.linearizeESM(I0, T, g1, H1, workspace) :
+            cdata.linearizeFC(I0, T, g1, H1, workspace);
+
+        const float g_err = (g0 - g1).norm() / g0.norm(),
+              H_err = (H0 - H1).norm() / H0.norm();
+        printf("%s [s=%d] gradient error %g Hessian error %g ssd error %g\n",
+               esm ? "ESM" : "FC ", s, g_err, H_err, ssd0 - ssd1);
+        if(g_err > 1e-4f || H_err > 1e-4f || ssd0 != ssd1) {
+          std::cerr << (esm ? "ESM" : "FC") << " linearization differs from the reference\n";
+          ++n_failed;
+        }
+      }
+    }
+  }
+
+  //
+  // tracking shifted images with the pyramid, ESM and FC should converge at
+  // least as well as IC, ESM in at most as many iterations
+  //
+  {
+    const cv::Rect bbox(200, 150, 200, 160);
+    for(float t : {1.0f, 3.0f, 6.0f})
+    {
+      float err_ic = 0.0f;
+      int n_iters_ic = 0;
+      const Matrix33f A = MakeTranslation(t, -0.5f*t);
+      const cv::Mat I1 = WarpAffine(I0, A);
+
+      for(auto linearizer : {AlgorithmParameters::LinearizerType::InverseCompositional,
+                             AlgorithmParameters::LinearizerType::ESM,
+                             AlgorithmParameters::LinearizerType::ForwardCompositional})
+      {
+        AlgorithmParameters p;
+        p.verbose = false;
+        p.num_levels = 2;
+        p.linearizer = linearizer;
+
+        BitPlanesTrackerPyramid<Homography> tracker(p);
+        tracker.setTemplate(I0, bbox);
+        const auto result = tracker.track(I1);
+
+        const float err = CornerError(bbox, result.T, A);
+        printf("%-20s shift %3.1f: %2d iterations, error %g\n",
+               ToString(linearizer).c_str(), t, result.num_iterations, err);
+
+        if(linearizer == AlgorithmParameters::LinearizerType::InverseCompositional) {
+          err_ic = err;
+          n_iters_ic = result.num_iterations;
+          continue;
+        }
+
+        if(err > std::max(err_ic, 0.1f) + 0.05f) {
+          std::cerr << ToString(linearizer) << " did not converge\n";
+          ++n_failed;
+        }
+
+        if(linearizer == AlgorithmParameters::LinearizerType::ESM &&
+           result.num_iterations > n_iters_ic) {
+          std::cerr << "ESM needed more iterations than IC\n";
+          ++n_failed;
+        }
+      }
+    }
+  }
+
+  //
+  // a template magnified 2.5x. The census gradients read a ring around the
+  // template, which must be in the smoothed footprint: the result of a fresh
+  // workspace must not depend on what a previous frame left in the buffer.
+  // The steps are in the template coordinates, the magnification must not
+  // make them overshoot
+  //
+  {
+    const cv::Rect bbox(280, 210, 64, 48);
+
+    Matrix33f S(Matrix33f::Identity()), S_big(Matrix33f::Identity());
+    S(0,0) = S(1,1) = 2.5f;
+    S_big(0,0) = S_big(1,1) = 4.0f;
+    const Matrix33f A = AboutCenter(bbox, S), A_big = AboutCenter(bbox, S_big);
+
+    const cv::Mat I1 = WarpAffine(I0, A);
+    cv::Mat noise(I0.size(), CV_8UC1);
+    cv::randu(noise, cv::Scalar(0), cv::Scalar(256));
+
+    Matrix33f T_init(A);
+    T_init(0,2) += 1.0f; T_init(1,2) -= 1.0f;
+
+    for(auto linearizer : {AlgorithmParameters::LinearizerType::ESM,
+                           AlgorithmParameters::LinearizerType::ForwardCompositional})
+    {
+      AlgorithmParameters p;
+      p.verbose = false;
+      p.linearizer = linearizer;
+
+      BitplanesTracker<Homography> fresh(p), stale(p);
+      fresh.setTemplate(I0, bbox);
+      stale.setTemplate(I0, bbox);
+
+      // fills the buffer of 'stale' around the template with noise
+      stale.track(noise, A_big);
+
+      const auto r0 = fresh.track(I1, T_init), r1 = stale.track(I1, T_init);
+
+      const float err = CornerError(bbox, r0.T, A),
+            err_init = CornerError(bbox, T_init, A);
+      printf("%-20s magnified 2.5x: %2d iterations, corner error %g (%g initially)\n",
+             ToString(linearizer).c_str(), r0.num_iterations, err, err_init);
+
+      if(err >= err_init) {
+        std::cerr << ToString(linearizer) << " diverged on the magnified template\n";
+        ++n_failed;
+      }
+
+      if((r0.T - r1.T).norm() > 0.0f || r0.num_iterations != r1.num_iterations) {
+        std::cerr << ToString(linearizer) << " read outside the smoothed footprint\n";
+        ++n_failed;
+      }
+
+    }
+  }
+
+  return TestResult(n_failed);
+}
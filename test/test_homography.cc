@@ -1,11 +1,28 @@
 #include "bitplanes/core/homography.h"
+#include "bitplanes/utils/timer.h"
 #include <iostream>
 #include <cmath>
+#include <cstdio>
 #include <Eigen/LU>
+#include <unsupported/Eigen/MatrixFunctions>
+
+/**
+ * the matrix of the Lie algebra of the parameters, see ParamsToMatrix
+ */
+static bp::Homography::Transform ParamsToAlgebra(const bp::Homography::ParameterVector& p)
+{
+  bp::Homography::Transform A;
+  A <<
+      p[3]/3 + p[4], p[2]+p[5]    , p[0],
+      -p[2]        , p[3]/3 - p[4], p[1],
+      p[6]         , p[7]         , -2*p[3]/3;
+  return A;
+}
 
 int main()
 {
   typename bp::Homography::ParameterVector p;
+  int n_failed = 0;
 
   for(int j = 0; j < 1000; ++j)
   {
@@ -14,14 +31,85 @@ int main()
     auto H = bp::Homography::ParamsToMatrix(p);
     auto p2 = bp::Homography::MatrixToParams(H);
 
-    if( std::abs(H.determinant() - 1) > 1e-6 )
+    if( std::abs(H.determinant() - 1) > 1e-6 ) {
       std::cerr << "determinant is bad " << H.determinant() << std::endl;
+      ++n_failed;
+    }
 
     float err = (p2 - p).squaredNorm();
-    if(err > 1e-6)
+    if(err > 1e-6) {
       std::cerr <<  "bad error " << err << std::endl;
+      ++n_failed;
+    }
   }
 
-  return 0;
-}
+  //
+  // the exponential must agree with Eigen's for the small updates of the
+  // tracker and for large parameters (with squarings)
+  //
+  for(float scale : {1e-4f, 1e-2f, 1e-1f, 1.0f, 4.0f})
+  {
+    float max_err = 0.0f;
+    for(int j = 0; j < 1000; ++j)
+    {
+      p = scale * bp::Homography::ParameterVector::Random();
+      const bp::Homography::Transform A = ParamsToAlgebra(p), H_ref = A.exp();
+      const float err = (bp::Homography::ParamsToMatrix(p) - H_ref).norm() / H_ref.norm();
+      max_err = std::max(max_err, err);
+    }
+
+    printf("exp relative error at scale %g: %g\n", scale, max_err);
+    if(max_err > 1e-5f) {
+      std::cerr << "bad exp at scale " << scale << std::endl;
+      ++n_failed;
+    }
+  }
+
+  //
+  // ParamsNorm is the first order of the norm of the log. The convergence
+  // test uses it as a scale, it must be close for the transforms of tracking
+  //
+  {
+    float max_err = 0.0f;
+    for(int j = 0; j < 1000; ++j)
+    {
+      p = bp::Homography::ParameterVector::Random();
+      p[0] *= 50.0f; p[1] *= 50.0f; // pixels
+      p.segment<4>(2) *= 0.05f;
+      p.tail<2>() *= 1e-4f;
 
+      const auto H = bp::Homography::ParamsToMatrix(p);
+      const float n_ref = bp::Homography::MatrixToParams(H).norm();
+      max_err = std::max(max_err, std::abs(bp::Homography::ParamsNorm(H) - n_ref) / n_ref);
+    }
+
+    printf("ParamsNorm relative error: %g\n", max_err);
+    if(max_err > 0.1f) {
+      std::cerr << "bad ParamsNorm" << std::endl;
+      ++n_failed;
+    }
+  }
+
+  {
+    p = 1e-3f * bp::Homography::ParameterVector::Random();
+    const bp::Homography::Transform A = ParamsToAlgebra(p);
+    const auto H = bp::Homography::ParamsToMatrix(p);
+
+    bp::Homography::Transform T;
+    float n = 0.0f;
+    const int N = 100000;
+    printf("ParamsToMatrix %0.0f ns, Eigen exp %0.0f ns\n",
+           1e6 * bp::TimeCode(N, [&]() { T = bp::Homography::ParamsToMatrix(p); }),
+           1e6 * bp::TimeCode(N, [&]() { T = A.exp(); }));
+    printf("ParamsNorm %0.0f ns, MatrixToParams %0.0f ns\n",
+           1e6 * bp::TimeCode(N, [&]() { n += bp::Homography::ParamsNorm(H); }),
+           1e6 * bp::TimeCode(N, [&]() { n += bp::Homography::MatrixToParams(H).norm(); }));
+  }
+
+  if(n_failed)
+    std::cerr << n_failed << " tests failed\n";
+  else
+    std::cout << "all good\n";
+
+  return n_failed != 0;
+}
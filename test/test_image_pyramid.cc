@@ -0,0 +1,171 @@
+#include "bitplanes/core/cpu.h"
+#include "bitplanes/core/internal/image_pyramid.h"
+#include "bitplanes/utils/timer.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <iostream>
+#include <vector>
+
+static const int NUM_LEVELS = 4;
+
+int main()
+{
+  cv::Mat I(1080, 1920, CV_8UC1);
+  cv::randu(I, cv::Scalar(0), cv::Scalar(256));
+  cv::GaussianBlur(I, I, cv::Size(), 1.5);
+
+  const std::vector<float> sigmas = {1.2f, 0.8f, 0.8f, 0.8f};
+
+  // reference: cv::pyrDown, then blur every level
+  std::vector<cv::Mat> P_ref(NUM_LEVELS), S_ref(NUM_LEVELS);
+  P_ref[0] = I;
+  for(int i = 1; i < NUM_LEVELS; ++i) {
+    cv::pyrDown(P_ref[i-1], P_ref[i]);
+    cv::GaussianBlur(P_ref[i], S_ref[i], cv::Size(), sigmas[i]);
+  }
+
+  const bp::SimdLevel levels[] = {
+    bp::SimdLevel::Scalar, bp::SimdLevel::SSE2, bp::SimdLevel::AVX2
+  };
+
+  int n_failed = 0;
+  for(auto level : levels)
+  {
+    if(bp::SetSimdLevel(level) != level) {
+      printf("%s is not supported\n", bp::ToString(level).c_str());
+      continue;
+    }
+
+    bp::ImagePyramid pyr;
+    pyr.init(I.size(), sigmas);
+    pyr.setImage(I);
+
+    // smoothing the coarsest level computes all the others
+    const int L = NUM_LEVELS - 1;
+    cv::Mat S(pyr.level(L).size(), CV_8UC1);
+    pyr.smooth(L, cv::Rect(cv::Point(0, 0), S.size()), S);
+
+    for(int i = 1; i < L; ++i)
+    {
+      const int n_diff = cv::countNonZero(pyr.level(i) != P_ref[i]);
+      if(n_diff) {
+        std::cerr << bp::ToString(level) << ": level " << i << " differs from "
+            << "cv::pyrDown at " << n_diff << " pixels\n";
+        ++n_failed;
+      }
+    }
+
+    // the fused filter approximates the blur after pyrDown, within the
+    // rounding of the two passes. A wrong tap or rounding is off by much more
+    cv::Mat diff;
+    cv::absdiff(S, S_ref[L], diff);
+    double max_diff = 0.0;
+    cv::minMaxLoc(diff, nullptr, &max_diff);
+    printf("[%s] smoothed level %d: mean abs diff %0.3f max %g\n",
+           bp::ToString(level).c_str(), L, cv::mean(diff)[0], max_diff);
+    if(cv::mean(diff)[0] > 0.25 || max_diff > 2.0) {
+      std::cerr << bp::ToString(level) << ": smoothed level is too far from "
+          << "the reference\n";
+      ++n_failed;
+    }
+
+    // level 0 is smoothed with the Gaussian alone, in fixed point as well
+    {
+      cv::Mat S0(I.size(), CV_8UC1), S0_ref;
+      pyr.smooth(0, cv::Rect(cv::Point(0, 0), S0.size()), S0);
+      cv::GaussianBlur(I, S0_ref, cv::Size(), sigmas[0]);
+
+      cv::Mat diff;
+      cv::absdiff(S0, S0_ref, diff);
+      double max_diff = 0.0;
+      cv::minMaxLoc(diff, nullptr, &max_diff);
+      printf("[%s] smoothed level 0: mean abs diff %0.3f max %g\n",
+             bp::ToString(level).c_str(), cv::mean(diff)[0], max_diff);
+      if(cv::mean(diff)[0] > 0.25 || max_diff > 2.0) {
+        std::cerr << bp::ToString(level) << ": smoothed level 0 is too far from "
+            << "cv::GaussianBlur\n";
+        ++n_failed;
+      }
+
+      const cv::Rect roi0(801, 401, 301, 301);
+      cv::Mat S0_roi(I.size(), CV_8UC1);
+      pyr.smooth(0, roi0, S0_roi);
+      const int n_diff = cv::countNonZero(S0_roi(roi0) != S0(roi0));
+      if(n_diff) {
+        std::cerr << bp::ToString(level) << ": smoothing the roi of level 0 "
+            << "differs from smoothing the level at " << n_diff << " pixels\n";
+        ++n_failed;
+      }
+    }
+
+    // odd sizes, the last row and column of each level are reflected
+    {
+      cv::Mat I_odd = I(cv::Rect(0, 0, 641, 479)).clone(), P = I_odd;
+      bp::ImagePyramid pyr_odd;
+      pyr_odd.init(I_odd.size(), sigmas);
+      pyr_odd.setImage(I_odd);
+
+      cv::Mat S_odd(pyr_odd.level(L).size(), CV_8UC1);
+      pyr_odd.smooth(L, cv::Rect(cv::Point(0, 0), S_odd.size()), S_odd);
+      for(int i = 1; i < L; ++i)
+      {
+        cv::Mat P_down;
+        cv::pyrDown(P, P_down);
+        P = P_down;
+        const int n_diff = cv::countNonZero(pyr_odd.level(i) != P);
+        if(n_diff) {
+          std::cerr << bp::ToString(level) << ": level " << i << " of size "
+              << P.cols << "x" << P.rows << " differs from cv::pyrDown at "
+              << n_diff << " pixels\n";
+          ++n_failed;
+        }
+      }
+    }
+
+    // the region around a 300x300 template
+    const cv::Rect roi(800/2, 400/2, 300/2, 300/2);
+
+    // smoothing a region gives the same pixels as smoothing the whole level
+    {
+      cv::Mat S_full(pyr.level(1).size(), CV_8UC1), S_roi(pyr.level(1).size(), CV_8UC1);
+      pyr.setImage(I);
+      pyr.smooth(1, roi, S_roi);
+      pyr.setImage(I);
+      pyr.smooth(1, cv::Rect(cv::Point(0, 0), S_full.size()), S_full);
+      const int n_diff = cv::countNonZero(S_roi(roi) != S_full(roi));
+      if(n_diff) {
+        std::cerr << bp::ToString(level) << ": smoothing the roi differs from "
+            << "smoothing the level at " << n_diff << " pixels\n";
+        ++n_failed;
+      }
+    }
+
+    cv::Mat S1(pyr.level(1).size(), CV_8UC1);
+    auto t_ms = bp::TimeCode(100, [&]() {
+                             pyr.setImage(I);
+                             pyr.smooth(1, roi, S1); });
+    printf("[%s] smooth level 1 roi %0.3f ms\n", bp::ToString(level).c_str(), t_ms);
+
+    t_ms = bp::TimeCode(100, [&]() {
+                        pyr.setImage(I);
+                        pyr.smooth(1, cv::Rect(cv::Point(0,0), S1.size()), S1); });
+    printf("[%s] smooth level 1 %0.3f ms\n", bp::ToString(level).c_str(), t_ms);
+  }
+
+  {
+    cv::Mat P1, S1;
+    auto t_ms = bp::TimeCode(100, [&]() {
+                             cv::pyrDown(I, P1);
+                             cv::GaussianBlur(P1, S1, cv::Size(), sigmas[1]); });
+    printf("[reference] pyrDown + GaussianBlur %0.3f ms\n", t_ms);
+  }
+
+  if(n_failed)
+    std::cerr << n_failed << " tests failed\n";
+  else
+    std::cout << "all good\n";
+
+  return n_failed != 0;
+}
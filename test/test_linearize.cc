@@ -1,10 +1,20 @@
+#include <bitplanes/core/config.h>
 #include <bitplanes/core/internal/bitplanes_channel_data_subsampled.h>
 #include <bitplanes/core/homography.h>
+#include <bitplanes/core/cpu.h>
 
 #include <bitplanes/utils/timer.h>
 
 #include <opencv2/highgui.hpp>
 
+#include <cstring>
+
+#if BITPLANES_WITH_TBB
+#include <tbb/task_arena.h>
+#elif BITPLANES_WITH_OPENMP
+#include <omp.h>
+#endif
+
 using namespace bp;
 
 int main()
@@ -42,11 +52,140 @@ int main()
   }
 
   {
-    typename BitPlanesChannelDataSubSampled<Homography>::Gradient gradient;
-    auto t = TimeCode(100, [&]() {
-                      cdata.doLinearize(Iw, gradient);
-                      });
-    printf("doLinearize %f\n", t);
+    Matrix33f T(Matrix33f::Identity());
+    T(0,2) = 2.5;
+    T(1,2) = 0.5;
+
+    typename BitPlanesChannelDataSubSampled<Homography>::Residuals residuals;
+    typename BitPlanesChannelDataSubSampled<Homography>::Gradient g0, g1;
+
+    cdata.warpImage(I0, T, roi, Iw);
+    cdata.computeResiduals(Iw, residuals);
+    g0 = cdata.jacobian().transpose() * residuals;
+
+    float sum_sq = cdata.linearize(I0, T, g1);
+    printf("linearize gradient error %g ssd error %g\n",
+           (g0 - g1).lpNorm<Eigen::Infinity>(), sum_sq - residuals.squaredNorm());
+
+    auto t = TimeCode(100, [&]() { cdata.linearize(I0, T, g1); });
+    printf("linearize %f\n", t);
+  }
+
+  {
+    Matrix33f T(Matrix33f::Identity());
+    T(0,2) = 2.5;
+    T(1,2) = 0.5;
+
+    BitPlanesChannelDataSubSampled<Homography> cdata_compact(1, true);
+    cdata_compact.set(I0, roi);
+
+    typename BitPlanesChannelDataSubSampled<Homography>::Gradient g0, g1;
+    cdata.linearize(I0, T, g0);
+    cdata_compact.linearize(I0, T, g1);
+    printf("compact gradient error %g hessian error %g\n",
+           (g0 - g1).lpNorm<Eigen::Infinity>(),
+           (cdata.hessian() - cdata_compact.hessian()).norm() / cdata.hessian().norm());
+
+    auto t = TimeCode(100, [&]() { cdata_compact.linearize(I0, T, g1); });
+    printf("linearize (compact) %f\n", t);
+  }
+
+  for(int s = 2; s <= 4; ++s)
+  {
+    // with subsampling, linearize warps only the stencils of the template pixels
+    Matrix33f T(Matrix33f::Identity());
+    T(0,2) = 2.5;
+    T(1,2) = 0.5;
+
+    BitPlanesChannelDataSubSampled<Homography> cdata_s(s);
+    cdata_s.set(I0, roi);
+
+    typename BitPlanesChannelDataSubSampled<Homography>::Residuals residuals;
+    typename BitPlanesChannelDataSubSampled<Homography>::Gradient g0, g1;
+
+    cdata_s.warpImage(I0, T, roi, Iw);
+    cdata_s.computeResiduals(Iw, residuals);
+    g0 = cdata_s.jacobian().transpose() * residuals;
+
+    float sum_sq = cdata_s.linearize(I0, T, g1);
+    printf("linearize [s=%d] gradient error %g ssd error %g\n", s,
+           (g0 - g1).lpNorm<Eigen::Infinity>(), sum_sq - residuals.squaredNorm());
+
+    auto t = TimeCode(100, [&]() { cdata_s.linearize(I0, T, g1); });
+    printf("linearize [s=%d] %f\n", s, t);
+  }
+
+  {
+    // all SIMD levels should give the same result as the scalar code
+    Matrix33f T(Matrix33f::Identity());
+    T(0,0) = 1.02; T(0,1) = 0.01; T(0,2) = 2.5;
+    T(1,2) = 0.5;  T(2,0) = 1e-5;
+
+    typename BitPlanesChannelDataSubSampled<Homography>::Gradient g0, g1;
+
+    SetSimdLevel(SimdLevel::Scalar);
+    float ssd0 = cdata.linearize(I0, T, g0);
+
+    for(auto level : {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+      if(SetSimdLevel(level) != level)
+        continue;
+
+      float ssd1 = cdata.linearize(I0, T, g1);
+      printf("linearize [%s] gradient error %g ssd error %g\n", ToString(level).c_str(),
+             (g0 - g1).lpNorm<Eigen::Infinity>(), ssd1 - ssd0);
+
+      auto t = TimeCode(100, [&]() { cdata.linearize(I0, T, g1); });
+      printf("linearize [%s] %f\n", ToString(level).c_str(), t);
+    }
+
+    SetSimdLevel(DetectSimdLevel());
+  }
+
+  {
+    // large templates are set and linearized in parallel, the result must not
+    // depend on the number of threads
+    Matrix33f T(Matrix33f::Identity());
+    T(0,0) = 1.02; T(0,1) = 0.01; T(0,2) = 2.5;
+    T(1,2) = 0.5;  T(2,0) = 1e-5;
+
+    const cv::Rect big_roi(1, 1, I0.cols - 2, I0.rows - 2);
+    for(bool compact : {false, true})
+    {
+      BitPlanesChannelDataSubSampled<Homography> cdata_big(1, compact);
+      cdata_big.set(I0, big_roi);
+
+      typename BitPlanesChannelDataSubSampled<Homography>::Gradient g0, g1;
+      const float ssd0 = cdata_big.linearize(I0, T, g0);
+
+      for(int n_threads = 1; n_threads <= 8; n_threads *= 2)
+      {
+        BitPlanesChannelDataSubSampled<Homography> cdata_t(1, compact);
+        float ssd1 = 0.0f;
+#if BITPLANES_WITH_TBB
+        tbb::task_arena arena(n_threads);
+        arena.execute([&]() {
+                      cdata_t.set(I0, big_roi);
+                      ssd1 = cdata_t.linearize(I0, T, g1); });
+#else
+#if BITPLANES_WITH_OPENMP
+        omp_set_num_threads(n_threads);
+#endif
+        cdata_t.set(I0, big_roi);
+        ssd1 = cdata_t.linearize(I0, T, g1);
+#endif
+        const auto& H0 = cdata_big.hessian();
+        const auto& H1 = cdata_t.hessian();
+        const bool same = ssd0 == ssd1 &&
+            0 == std::memcmp(g0.data(), g1.data(), g0.size() * sizeof(float)) &&
+            0 == std::memcmp(H0.data(), H1.data(), H0.size() * sizeof(float));
+        printf("linearize [%s, %d threads] %s\n", compact ? "compact" : "dense",
+               n_threads, same ? "same" : "DIFFERENT");
+      }
+
+      auto t = TimeCode(100, [&]() { cdata_big.linearize(I0, T, g1); });
+      printf("linearize [%s, full image] %f\n", compact ? "compact" : "dense", t);
+    }
   }
 
   return 0;
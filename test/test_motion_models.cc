@@ -0,0 +1,168 @@
+#include <bitplanes/core/bitplanes_tracker_pyramid.h>
+#include <bitplanes/core/internal/bitplanes_channel_data_subsampled.h>
+#include <bitplanes/core/homography.h>
+#include <bitplanes/core/affine.h>
+#include <bitplanes/core/translation.h>
+#include <bitplanes/utils/timer.h>
+#include <bitplanes/test/test_utils.h>
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace bp;
+
+/**
+ * \return the largest difference between the warp Jacobian of M and the
+ * derivative (by central differences) of the update T_inv * W(p) * T, where T
+ * is the coordinate normalization of the template
+ */
+template <class M>
+static float CheckWarpJacobian(const cv::Rect& roi)
+{
+  typedef BitPlanesChannelDataSubSampled<M> ChannelData;
+  typedef typename M::ParameterVector ParameterVector;
+
+  Matrix33f T, T_inv;
+  ChannelData().getCoordinateNormalization(roi, T, T_inv);
+
+  float ret = 0.0f;
+  for(const auto& pt : {cv::Point(roi.x, roi.y), cv::Point(roi.x + roi.width, roi.y + 7),
+                        cv::Point(roi.x + roi.width/3, roi.y + roi.height)})
+  {
+    const auto Jw = M::ComputeWarpJacobian(pt.x, pt.y, T(0,0), T_inv(0,2), T_inv(1,2));
+
+    for(int k = 0; k < M::DOF; ++k)
+    {
+      const float eps = 1e-3f;
+      ParameterVector dp(ParameterVector::Zero());
+      dp[k] = eps;
+
+      const Vector3f x(pt.x, pt.y, 1.0f);
+      const Vector3f x1 = T_inv * M::ParamsToMatrix(dp) * T * x,
+            x0 = T_inv * M::ParamsToMatrix(-dp) * T * x;
+      const Vector2f d = (x1.head<2>() / x1[2] - x0.head<2>() / x0[2]) / (2*eps);
+
+      ret = std::max(ret, (d - Jw.col(k)).norm() / std::max(1.0f, Jw.col(k).norm()));
+    }
+  }
+
+  return ret;
+}
+
+/**
+ * tracks I0 warped with the affine transform A with a pyramid tracker for M,
+ * and returns the largest error at the corners of the template
+ */
+template <class M>
+static float Track(const char* name, const cv::Mat& I0, const cv::Rect& bbox,
+                   const Matrix33f& A, int num_levels = 2,
+                   const std::vector<AlgorithmParameters::MotionType>& schedule = {})
+{
+  const cv::Mat I1 = WarpAffine(I0, A);
+
+  AlgorithmParameters p;
+  p.verbose = false;
+  p.num_levels = num_levels;
+  p.motion_schedule = schedule;
+
+  BitPlanesTrackerPyramid<M> tracker(p);
+  const auto t_template = TimeCode(5, [&]() { tracker.setTemplate(I0, bbox); });
+
+  Result result;
+  const auto t_track = TimeCode(5, [&]() { result = tracker.track(I1); });
+
+  const float err = CornerError(bbox, result.T, A);
+  printf("%-24s setTemplate %7.3f ms track %7.3f ms %2d iterations, corner error %g\n",
+         name, t_template, t_track, result.num_iterations, err);
+  return err;
+}
+
+int main()
+{
+  const cv::Mat I0 = MakeSyntheticFrame();
+
+  const cv::Rect bbox(200, 150, 200, 160);
+
+  int n_failed = 0;
+
+  //
+  // the warp Jacobians must be the derivative of the update of the tracker
+  //
+  {
+    const float e_h = CheckWarpJacobian<Homography>(bbox),
+          e_a = CheckWarpJacobian<Affine>(bbox),
+          e_t = CheckWarpJacobian<Translation>(bbox);
+    printf("warp Jacobian error: Homography %g Affine %g Translation %g\n", e_h, e_a, e_t);
+    if(e_h > 1e-2f || e_a > 1e-2f || e_t > 1e-2f) {
+      std::cerr << "bad warp Jacobian\n";
+      ++n_failed;
+    }
+  }
+
+  //
+  // parameters to matrix and back
+  //
+  {
+    Affine::ParameterVector p_a;
+    p_a << 0.01f, -0.02f, 1.5f, 0.03f, -0.01f, -2.0f;
+    Translation::ParameterVector p_t(1.5f, -2.0f);
+
+    const float e_a = (Affine::MatrixToParams(Affine::ParamsToMatrix(p_a)) - p_a).norm(),
+          e_t = (Translation::MatrixToParams(Translation::ParamsToMatrix(p_t)) - p_t).norm();
+    if(e_a > 1e-6f || e_t > 1e-6f) {
+      std::cerr << "bad parameters round trip " << e_a << " " << e_t << "\n";
+      ++n_failed;
+    }
+  }
+
+  //
+  // each model tracks a motion it can represent
+  //
+  {
+    Matrix33f A = MakeTranslation(2.5f, -1.5f);
+    if(Track<Translation>("Translation", I0, bbox, A) > 0.1f) {
+      std::cerr << "Translation did not converge\n";
+      ++n_failed;
+    }
+
+    // about the center of the template, the corners move by 2 to 3 pixels
+    A << 1.02f, 0.01f, 1.5f,
+         -0.015f, 0.99f, -1.0f,
+         0.0f, 0.0f, 1.0f;
+    A = AboutCenter(bbox, A);
+    for(float err : {Track<Affine>("Affine", I0, bbox, A),
+                     Track<Homography>("Homography", I0, bbox, A)})
+      if(err > 0.1f) {
+        std::cerr << "Affine motion did not converge\n";
+        ++n_failed;
+      }
+  }
+
+  //
+  // a homography with the coarse levels estimating a translation, then an
+  // affine motion, must converge as well as with a homography at all levels
+  //
+  {
+    typedef AlgorithmParameters::MotionType Motion;
+
+    Matrix33f A;
+    A << 1.03f, 0.02f, 6.0f,
+         -0.02f, 0.98f, -4.0f,
+         0.0f, 0.0f, 1.0f;
+    A = AboutCenter(bbox, A);
+
+    const float e_h = Track<Homography>("Homography", I0, bbox, A, 3),
+          e_c = Track<Homography>("Translation,Affine,H", I0, bbox, A, 3,
+                                  {Motion::Translation, Motion::Affine});
+    if(e_h > 0.1f || e_c > 0.1f) {
+      std::cerr << "motion schedule did not converge\n";
+      ++n_failed;
+    }
+  }
+
+  return TestResult(n_failed);
+}
@@ -0,0 +1,83 @@
+#include <bitplanes/core/bitplanes_tracker_pyramid.h>
+#include <bitplanes/core/multi_template_tracker.h>
+#include <bitplanes/core/homography.h>
+#include <bitplanes/utils/timer.h>
+#include <bitplanes/test/test_utils.h>
+
+#include <opencv2/core.hpp>
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using namespace bp;
+
+static const int NUM_FRAMES = 10;
+
+int main()
+{
+  const cv::Mat I0 = MakeSyntheticFrame(cv::Size(1280, 720));
+
+  // the frames drift by a sub-pixel amount
+  std::vector<cv::Mat> frames(NUM_FRAMES);
+  for(int i = 0; i < NUM_FRAMES; ++i) {
+    const float t = 0.4f * (i + 1);
+    frames[i] = WarpAffine(I0, MakeTranslation(t, -0.5f*t));
+  }
+
+  const std::vector<cv::Rect> bboxes = {
+    cv::Rect(100, 100, 160, 120), cv::Rect(400, 300, 200, 200),
+    cv::Rect(900, 80, 150, 150), cv::Rect(700, 450, 240, 180),
+    cv::Rect(180, 480, 120, 160), cv::Rect(1000, 500, 180, 140) };
+
+  AlgorithmParameters p;
+  p.verbose = false;
+  p.num_levels = 2;
+
+  MultiTemplateTracker<Homography> multi(p);
+  std::vector<BitPlanesTrackerPyramid<Homography>> single;
+  for(const auto& bbox : bboxes) {
+    multi.addTemplate(I0, bbox);
+    single.push_back( BitPlanesTrackerPyramid<Homography>(p) );
+    single.back().setTemplate(I0, bbox);
+  }
+
+  // a copied and moved tracker tracks with its own pyramid, as the original
+  BitPlanesTrackerPyramid<Homography> copy(single.front()), moved(std::move(copy));
+  const Result r_moved = moved.track(frames.front());
+
+  int n_failed = 0;
+  double t_multi = 0.0, t_single = 0.0;
+  for(const auto& I : frames)
+  {
+    Timer timer;
+    const auto& results = multi.track(I);
+    t_multi += timer.stop().count();
+
+    timer.start();
+    std::vector<Result> expected;
+    for(auto& t : single)
+      expected.push_back( t.track(I) );
+    t_single += timer.stop().count();
+
+    if(&I == &frames.front() && (r_moved.T - expected.front().T).norm() > 1e-6f) {
+      std::cerr << "the moved copy differs from the original\n";
+      ++n_failed;
+    }
+
+    // the shared pyramid has the same pixels, so the results must agree
+    for(size_t i = 0; i < bboxes.size(); ++i)
+    {
+      const float err = (results[i].T - expected[i].T).norm();
+      if(err > 1e-4f) {
+        std::cerr << "template " << i << " differs by " << err << "\n";
+        ++n_failed;
+      }
+    }
+  }
+
+  printf("%zu templates: shared pyramid %0.3f ms/frame, independent %0.3f ms/frame\n",
+         bboxes.size(), t_multi / NUM_FRAMES, t_single / NUM_FRAMES);
+
+  return TestResult(n_failed);
+}
@@ -0,0 +1,75 @@
+#include <bitplanes/core/bitplanes_tracker_pyramid.h>
+#include <bitplanes/core/homography.h>
+#include <bitplanes/utils/timer.h>
+#include <bitplanes/test/test_utils.h>
+
+#include <opencv2/core.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace bp;
+
+int main()
+{
+  const cv::Mat I0 = MakeSyntheticFrame();
+  const cv::Mat I1 = WarpAffine(I0, MakeTranslation(2.5f, -1.5f));
+
+  const cv::Rect bbox(160, 120, 320, 240);
+  const std::string filename = "/tmp/bitplanes_test_template.bin";
+
+  int n_failed = 0;
+  typedef AlgorithmParameters::TemplateStorage Storage;
+  typedef AlgorithmParameters::LinearizerType Linearizer;
+  typedef AlgorithmParameters::MotionType Motion;
+  const struct {
+    Storage storage;
+    Linearizer linearizer;
+    std::vector<Motion> motion_schedule;
+  } configs[] = {
+    {Storage::Dense, Linearizer::InverseCompositional, {}},
+    {Storage::Compact, Linearizer::InverseCompositional, {}},
+    {Storage::Census, Linearizer::ForwardCompositional, {}},
+    {Storage::Dense, Linearizer::InverseCompositional, {Motion::Translation, Motion::Affine}}};
+
+  for(const auto& config : configs)
+  {
+    AlgorithmParameters p;
+    p.verbose = false;
+    p.num_levels = 3;
+    p.template_storage = config.storage;
+    p.linearizer = config.linearizer;
+    p.motion_schedule = config.motion_schedule;
+
+    BitPlanesTrackerPyramid<Homography> tracker(p);
+    auto t_ms = TimeCode(10, [&]() { tracker.setTemplate(I0, bbox); });
+    printf("setTemplate %0.3f ms\n", t_ms);
+
+    tracker.save(filename);
+
+    BitPlanesTrackerPyramid<Homography> loaded(p);
+    t_ms = TimeCode(10, [&]() { loaded.load(filename); });
+    printf("load %0.3f ms\n", t_ms);
+
+    if(loaded.numLevels() != tracker.numLevels() ||
+       loaded.levelDOF() != tracker.levelDOF()) {
+      std::cerr << "loaded " << loaded.numLevels() << " levels, expected "
+          << tracker.numLevels() << "\n";
+      ++n_failed;
+      continue;
+    }
+
+    // the loaded template must track exactly as the original
+    const auto r0 = tracker.track(I1), r1 = loaded.track(I1);
+    const float err = (r0.T - r1.T).norm();
+    if(err > 0.0f || r0.num_iterations != r1.num_iterations) {
+      std::cerr << "loaded template differs by " << err << "\n";
+      ++n_failed;
+    }
+  }
+
+  std::remove(filename.c_str());
+
+  return TestResult(n_failed);
+}
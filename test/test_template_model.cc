@@ -0,0 +1,78 @@
+#include <bitplanes/core/bitplanes_tracker.h>
+#include <bitplanes/core/template_model.h>
+#include <bitplanes/core/homography.h>
+#include <bitplanes/test/test_utils.h>
+
+#include <opencv2/core.hpp>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace bp;
+
+static const int NUM_FRAMES = 10;
+static const int NUM_THREADS = 4;
+
+int main()
+{
+  const cv::Mat I0 = MakeSyntheticFrame();
+
+  std::vector<cv::Mat> frames(NUM_FRAMES);
+  for(int i = 0; i < NUM_FRAMES; ++i) {
+    const float t = 0.3f * (i + 1);
+    frames[i] = WarpAffine(I0, MakeTranslation(t, 0.5f*t));
+  }
+
+  const cv::Rect bbox(200, 150, 200, 160);
+
+  AlgorithmParameters p;
+  p.verbose = false;
+
+  // the reference, a tracker that owns its model
+  BitplanesTracker<Homography> tracker(p);
+  tracker.setTemplate(I0, bbox);
+
+  std::vector<Result> expected;
+  for(const auto& I : frames)
+    expected.push_back( tracker.track(I, expected.empty() ?
+                                      Matrix33f::Identity() : expected.back().T) );
+
+  //
+  // several streams track the same model concurrently, each with its own
+  // workspace
+  //
+  const auto model = TemplateModel<Homography>::Create(I0, bbox, p);
+
+  std::vector<std::vector<Result>> results(NUM_THREADS);
+  std::vector<std::thread> threads;
+  for(int k = 0; k < NUM_THREADS; ++k)
+  {
+    threads.emplace_back([&, k]() {
+      TrackingWorkspace<Homography> workspace;
+      Matrix33f T = Matrix33f::Identity();
+      for(const auto& I : frames) {
+        results[k].push_back( track(*model, workspace, I, T) );
+        T = results[k].back().T;
+      }
+    });
+  }
+
+  for(auto& t : threads)
+    t.join();
+
+  int n_failed = 0;
+  for(int k = 0; k < NUM_THREADS; ++k)
+  {
+    for(int i = 0; i < NUM_FRAMES; ++i)
+    {
+      const float err = (results[k][i].T - expected[i].T).norm();
+      if(err > 1e-5f) {
+        std::cerr << "thread " << k << " frame " << i << " differs by " << err << "\n";
+        ++n_failed;
+      }
+    }
+  }
+
+  return TestResult(n_failed);
+}
@@ -0,0 +1,132 @@
+#include <bitplanes/core/bitplanes_tracker_pyramid.h>
+#include <bitplanes/core/homography.h>
+#include <bitplanes/test/test_utils.h>
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+using namespace bp;
+
+/**
+ * tracks I1 from the identity with the budget, and returns the result and
+ * the time of the call in milliseconds
+ */
+static Result Track(BitPlanesTrackerPyramid<Homography>& tracker, const cv::Mat& I1,
+                    double& t_ms)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  const auto ret = tracker.track(I1, Matrix33f::Identity());
+  t_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+  return ret;
+}
+
+int main()
+{
+  const cv::Mat I0 = MakeSyntheticFrame();
+
+  // a hard frame, the template moves by about 8 pixels
+  Matrix33f A = MakeTranslation(6.0f, -5.0f);
+  A(0,0) = 1.01f;
+  const cv::Mat I1 = WarpAffine(I0, A);
+
+  const cv::Rect bbox(160, 120, 320, 240);
+  const float err_init = CornerError(bbox, Matrix33f::Identity(), A);
+
+  AlgorithmParameters p;
+  p.verbose = false;
+  p.num_levels = 3;
+
+  int n_failed = 0;
+
+  //
+  // without a budget, for reference. The time is the fastest of a few warm
+  // runs, the result is the same for all of them
+  //
+  BitPlanesTrackerPyramid<Homography> tracker(p);
+  tracker.setTemplate(I0, bbox);
+
+  double t_ref = 0.0;
+  auto r_ref = Track(tracker, I1, t_ref);
+  for(int k = 0; k < 5; ++k)
+  {
+    double t_ms = 0.0;
+    r_ref = Track(tracker, I1, t_ms);
+    t_ref = k ? std::min(t_ref, t_ms) : t_ms;
+  }
+
+  printf("no budget:   %8.3f ms %2d iterations, %-22s corner error %g\n", t_ref,
+         r_ref.num_iterations, ToString(r_ref.status).c_str(), CornerError(bbox, r_ref.T, A));
+
+  //
+  // a generous budget does not change the result
+  //
+  {
+    p.time_budget_ms = 1000 * t_ref;
+    BitPlanesTrackerPyramid<Homography> t(p);
+    t.setTemplate(I0, bbox);
+
+    double t_ms = 0.0;
+    const auto r = Track(t, I1, t_ms);
+    if((r.T - r_ref.T).norm() > 0.0f || r.status != r_ref.status ||
+       r.num_iterations != r_ref.num_iterations) {
+      std::cerr << "the budget changed the result\n";
+      ++n_failed;
+    }
+  }
+
+  //
+  // a budget shorter than any iteration: the coarsest level makes its first
+  // update, then the deadline stops it and skips the other levels. The pose is
+  // still better than the initialization
+  //
+  {
+    p.time_budget_ms = 1e-3f;
+    BitPlanesTrackerPyramid<Homography> t(p);
+    t.setTemplate(I0, bbox);
+
+    double t_ms = 0.0;
+    const auto r = Track(t, I1, t_ms);
+    const float err = CornerError(bbox, r.T, A);
+    printf("budget %5.3f: %8.3f ms %2d iterations, %-22s corner error %g\n",
+           p.time_budget_ms, t_ms, r.num_iterations, ToString(r.status).c_str(), err);
+
+    if(r.status != OptimizerStatus::TimeBudgetExceeded) {
+      std::cerr << "expected TimeBudgetExceeded\n";
+      ++n_failed;
+    }
+
+    if(r.num_iterations >= r_ref.num_iterations) {
+      std::cerr << "the budget did not stop the iterations\n";
+      ++n_failed;
+    }
+
+    if(err >= err_init) {
+      std::cerr << "the pose is not better than the initialization\n";
+      ++n_failed;
+    }
+  }
+
+  //
+  // the outcome of budgets in between depends on the load of the machine, the
+  // overrun is only printed
+  //
+  for(double fraction : {0.5, 0.2, 0.05})
+  {
+    p.time_budget_ms = fraction * t_ref;
+    BitPlanesTrackerPyramid<Homography> t(p);
+    t.setTemplate(I0, bbox);
+
+    double t_ms = 0.0;
+    const auto r = Track(t, I1, t_ms);
+    printf("budget %5.3f: %8.3f ms %2d iterations, %-22s corner error %g overrun %g ms\n",
+           p.time_budget_ms, t_ms, r.num_iterations, ToString(r.status).c_str(),
+           CornerError(bbox, r.T, A), std::max(0.0, t_ms - p.time_budget_ms));
+  }
+
+  return TestResult(n_failed);
+}
@@ -0,0 +1,96 @@
+#ifndef BITPLANES_TEST_TEST_UTILS_H
+#define BITPLANES_TEST_TEST_UTILS_H
+
+#include <bitplanes/core/types.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <Eigen/LU>
+
+#include <algorithm>
+#include <iostream>
+
+namespace bp {
+
+/**
+ * \return a random texture, smoothed so that the trackers converge from a few
+ * pixels away
+ */
+inline cv::Mat MakeSyntheticFrame(const cv::Size& size = cv::Size(640, 480))
+{
+  cv::Mat ret(size, CV_8UC1);
+  cv::randu(ret, cv::Scalar(0), cv::Scalar(256));
+  cv::GaussianBlur(ret, ret, cv::Size(), 2.0);
+  return ret;
+}
+
+/**
+ * \return the transform that translates by (tx, ty)
+ */
+inline Matrix33f MakeTranslation(float tx, float ty)
+{
+  Matrix33f ret(Matrix33f::Identity());
+  ret(0,2) = tx;
+  ret(1,2) = ty;
+  return ret;
+}
+
+/**
+ * \return the transform A about the center of 'bbox'
+ */
+inline Matrix33f AboutCenter(const cv::Rect& bbox, const Matrix33f& A)
+{
+  const Matrix33f C = MakeTranslation(bbox.x + 0.5f*bbox.width,
+                                      bbox.y + 0.5f*bbox.height);
+  return C * A * C.inverse();
+}
+
+/**
+ * \return I warped with the affine transform A, i.e. the pixel x of I moves
+ * to A*x
+ */
+inline cv::Mat WarpAffine(const cv::Mat& I, const Matrix33f& A)
+{
+  const cv::Mat A_cv = (cv::Mat_<double>(2,3) <<
+                        A(0,0), A(0,1), A(0,2), A(1,0), A(1,1), A(1,2));
+  cv::Mat ret;
+  cv::warpAffine(I, ret, A_cv, I.size());
+  return ret;
+}
+
+/**
+ * \return the largest distance between the corners of 'bbox' mapped with T
+ * and with A
+ */
+inline float CornerError(const cv::Rect& bbox, const Matrix33f& T, const Matrix33f& A)
+{
+  float err = 0.0f;
+  for(float x : {bbox.x, bbox.x + bbox.width})
+    for(float y : {bbox.y, bbox.y + bbox.height})
+    {
+      const Vector3f p = T * Vector3f(x, y, 1.0f), q = A * Vector3f(x, y, 1.0f);
+      err = std::max(err, (p.head<2>() / p[2] - q.head<2>() / q[2]).norm());
+    }
+
+  return err;
+}
+
+/**
+ * prints the summary of a test
+ *
+ * \return the exit code of the test
+ */
+inline int TestResult(int n_failed)
+{
+  if(n_failed)
+    std::cerr << n_failed << " tests failed\n";
+  else
+    std::cout << "all good\n";
+
+  return n_failed != 0;
+}
+
+}; // bp
+
+#endif // BITPLANES_TEST_TEST_UTILS_H
@@ -0,0 +1,183 @@
+#include <bitplanes/core/bitplanes_tracker.h>
+#include <bitplanes/core/bitplanes_tracker_pyramid.h>
+#include <bitplanes/core/homography.h>
+#include <bitplanes/utils/memory.h>
+#include <bitplanes/test/test_utils.h>
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+using namespace bp;
+
+static const int NUM_FRAMES = 20;
+
+//
+// GetAllocationCount sees only the library buffers. To catch the allocations
+// made anywhere else, e.g. inside OpenCV, we count the calls to the global
+// allocators of the process. With glibc we replace malloc, which operator new
+// and cv::Mat use, elsewhere only operator new. The sanitizers replace malloc
+// themselves
+//
+static std::atomic<size_t> g_num_heap_allocations(0);
+
+#if defined(__has_feature)
+#  if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer)
+#    define BP_TEST_HAS_SANITIZER 1
+#  endif
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#  define BP_TEST_HAS_SANITIZER 1
+#endif
+
+#if defined(__GLIBC__) && !defined(BP_TEST_HAS_SANITIZER)
+extern "C" {
+
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+
+void* malloc(size_t n)
+{
+  ++g_num_heap_allocations;
+  return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size)
+{
+  ++g_num_heap_allocations;
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n)
+{
+  ++g_num_heap_allocations;
+  return __libc_realloc(p, n);
+}
+
+void* memalign(size_t alignment, size_t n)
+{
+  ++g_num_heap_allocations;
+  return __libc_memalign(alignment, n);
+}
+
+void* aligned_alloc(size_t alignment, size_t n)
+{
+  return memalign(alignment, n);
+}
+
+int posix_memalign(void** p, size_t alignment, size_t n)
+{
+  *p = memalign(alignment, n);
+  return (*p || !n) ? 0 : ENOMEM;
+}
+
+} // extern "C"
+#else
+void* operator new(size_t n)
+{
+  ++g_num_heap_allocations;
+  if(void* p = std::malloc(n ? n : 1))
+    return p;
+
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#endif
+
+/**
+ * \return the number of allocations, those of the library buffers and those
+ * of the process
+ */
+static size_t AllocationCount()
+{
+  return GetAllocationCount() + g_num_heap_allocations.load();
+}
+
+/**
+ * \return a sequence of images translated by a sub-pixel amount
+ */
+static std::vector<cv::Mat> MakeFrames(const cv::Mat& I0)
+{
+  std::vector<cv::Mat> ret(NUM_FRAMES);
+  for(int i = 0; i < NUM_FRAMES; ++i)
+  {
+    const float t = 0.25f * (i % 5);
+    ret[i] = WarpAffine(I0, MakeTranslation(t, 0.5f*t));
+  }
+
+  return ret;
+}
+
+/**
+ * Tracks the frames twice, the first pass warms up the buffers and the second
+ * must not allocate
+ *
+ * \return the number of allocations in the second pass
+ */
+template <class TrackFunc> static
+size_t CountSteadyStateAllocations(TrackFunc track, const std::vector<cv::Mat>& frames)
+{
+  for(const auto& I : frames)
+    track(I);
+
+  const auto n_alloc = AllocationCount();
+  for(const auto& I : frames)
+    track(I);
+
+  return AllocationCount() - n_alloc;
+}
+
+int main()
+{
+  const cv::Mat I0 = MakeSyntheticFrame();
+
+  const auto frames = MakeFrames(I0);
+  const cv::Rect bbox(200, 150, 200, 160);
+
+  int n_failed = 0;
+  for(auto storage : {AlgorithmParameters::TemplateStorage::Dense,
+                      AlgorithmParameters::TemplateStorage::Compact})
+  {
+    for(int s : {1, 2, 4})
+    {
+      AlgorithmParameters p;
+      p.verbose = false;
+      p.subsampling = s;
+      p.template_storage = storage;
+      p.num_levels = 2;
+
+      BitplanesTracker<Homography> tracker(p);
+      tracker.setTemplate(I0, bbox);
+      const auto n_single = CountSteadyStateAllocations(
+          [&](const cv::Mat& I) { tracker.track(I); }, frames);
+
+      BitPlanesTrackerPyramid<Homography> tracker_pyr(p);
+      tracker_pyr.setTemplate(I0, bbox);
+      const auto n_pyr = CountSteadyStateAllocations(
+          [&](const cv::Mat& I) { tracker_pyr.track(I); }, frames);
+
+      if(n_single || n_pyr) {
+        std::cerr << "subsampling " << s
+            << (storage == AlgorithmParameters::TemplateStorage::Compact ?
+                " compact: " : " dense: ") << n_single << " allocations (single level) "
+            << n_pyr << " allocations (pyramid)\n";
+        ++n_failed;
+      }
+    }
+  }
+
+  return TestResult(n_failed);
+}
@@ -0,0 +1,69 @@
+/*
+   This file is part of bitplanes.
+
+   bitplanes is free software: you can redistribute it and/or modify
+   it under the terms of the Lesser GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   bitplanes is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   Lesser GNU General Public License for more details.
+
+   You should have received a copy of the Lesser GNU General Public License
+   along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitplanes/utils/mapped_file.h"
+#include "bitplanes/utils/error.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include <cstring>
+
+namespace bp {
+
+MappedFile::MappedFile(const std::string& filename)
+  : _data(nullptr), _size(0)
+{
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0)
+    THROW_ERROR(Format("failed to open '%s': %s", filename.c_str(),
+                       std::strerror(errno)).c_str());
+
+  struct stat buf;
+  if(0 != ::fstat(fd, &buf)) {
+    const int err = errno;
+    ::close(fd);
+    THROW_ERROR(Format("failed to stat '%s': %s", filename.c_str(),
+                       std::strerror(err)).c_str());
+  }
+
+  _size = static_cast<size_t>(buf.st_size);
+  if(_size) {
+    void* p = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+    const int err = errno;
+    ::close(fd); // the mapping stays valid
+
+    if(p == MAP_FAILED)
+      THROW_ERROR(Format("failed to map '%s': %s", filename.c_str(),
+                         std::strerror(err)).c_str());
+
+    _data = static_cast<const uint8_t*>(p);
+  } else {
+    ::close(fd);
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if(_data)
+    ::munmap(const_cast<uint8_t*>(_data), _size);
+}
+
+}; // bp
@@ -0,0 +1,54 @@
+/*
+  This file is part of bitplanes.
+
+  bitplanes is free software: you can redistribute it and/or modify
+  it under the terms of the Lesser GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  bitplanes is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  Lesser GNU General Public License for more details.
+
+  You should have received a copy of the Lesser GNU General Public License
+  along with bitplanes.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITPLANES_UTILS_MAPPED_FILE_H
+#define BITPLANES_UTILS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bp {
+
+/**
+ * A file mapped read-only in memory (posix mmap). The pages are loaded on
+ * demand and shared with the other processes that map the same file
+ */
+class MappedFile
+{
+ public:
+  /**
+   * Maps the file, throws an Error on failure
+   */
+  explicit MappedFile(const std::string& filename);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  inline const uint8_t* data() const { return _data; }
+  inline size_t size() const { return _size; }
+
+ private:
+  const uint8_t* _data;
+  size_t _size;
+}; // MappedFile
+
+}; // bp
+
+#endif // BITPLANES_UTILS_MAPPED_FILE_H
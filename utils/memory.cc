@@ -22,9 +22,12 @@
 #include <cassert>
 #include <stdexcept>
 #include <cstring>
+#include <atomic>
 
 namespace bp {
 
+static std::atomic<size_t> g_num_allocations(0);
+
 static inline void throw_bad_alloc()
 {
 #if 1 || TT_USE_EXCEPTIONS
@@ -91,11 +94,13 @@ static inline void* _aligned_realloc(void *ptr, size_t nbytes, int alignment)
 
 void* aligned_malloc(size_t nbytes, int alignment)
 {
+  ++g_num_allocations;
   return _aligned_malloc(nbytes, alignment);
 }
 
 void* aligned_realloc(void* ptr, size_t nbytes, int alignment)
 {
+  ++g_num_allocations;
   void* ret = _aligned_realloc(ptr, nbytes, alignment);
 
   if(!ret && nbytes)
@@ -109,5 +114,116 @@ void aligned_free(void* ptr)
   _aligned_free(ptr);
 }
 
+size_t GetAllocationCount()
+{
+  return g_num_allocations.load();
+}
+
+void RecordAllocation()
+{
+  ++g_num_allocations;
+}
+
+Arena::Arena(size_t nbytes)
+  : _data(nullptr), _capacity(0), _used(0)
+{
+  reserve(nbytes);
+}
+
+Arena::Arena(const Arena& other)
+  : Arena(other._capacity) {}
+
+Arena& Arena::operator=(const Arena& other)
+{
+  if(this != &other) {
+    release();
+    reserve(other._capacity);
+  }
+
+  return *this;
+}
+
+Arena::Arena(Arena&& other) noexcept
+  : _data(other._data), _capacity(other._capacity), _used(other._used),
+    _overflow(std::move(other._overflow))
+{
+  other._data = nullptr;
+  other._capacity = other._used = 0;
+  other._overflow.clear();
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+  if(this != &other) {
+    release();
+    _data = other._data;
+    _capacity = other._capacity;
+    _used = other._used;
+    _overflow = std::move(other._overflow);
+
+    other._data = nullptr;
+    other._capacity = other._used = 0;
+    other._overflow.clear();
+  }
+
+  return *this;
+}
+
+Arena::~Arena() { release(); }
+
+void Arena::reserve(size_t nbytes)
+{
+  if(nbytes <= _capacity)
+    return;
+
+  reset();
+  aligned_free(_data);
+  _data = static_cast<uint8_t*>( aligned_malloc(nbytes) );
+  _capacity = nbytes;
+}
+
+void* Arena::allocateBytes(size_t nbytes)
+{
+  nbytes = AlignedSize(nbytes);
+
+  void* ret = nullptr;
+  if(_used + nbytes <= _capacity) {
+    ret = _data + _used;
+  } else {
+    ret = aligned_malloc(nbytes);
+    _overflow.push_back(ret);
+  }
+
+  _used += nbytes;
+  return ret;
+}
+
+void Arena::reset()
+{
+  if(!_overflow.empty()) {
+    for(auto p : _overflow)
+      aligned_free(p);
+    _overflow.clear();
+
+    // grow to the high-water mark
+    const size_t nbytes = _used;
+    _used = 0;
+    reserve(nbytes);
+  }
+
+  _used = 0;
+}
+
+void Arena::release()
+{
+  for(auto p : _overflow)
+    aligned_free(p);
+  _overflow.clear();
+
+  aligned_free(_data);
+  _data = nullptr;
+  _capacity = _used = 0;
+}
+
 } // bp
 
@@ -20,6 +20,8 @@
 
 #include <memory>
 #include <stdexcept>
+#include <vector>
+#include <cstdint>
 
 #include "bitplanes/core/internal/intrin.h"
 
@@ -41,6 +43,20 @@ void* aligned_malloc(size_t nbytes, int alignment = TT_DEFAULT_ALIGNMENT);
 void* aligned_realloc(void* ptr, size_t nbytes, int alignment = TT_DEFAULT_ALIGNMENT);
 void aligned_free(void*);
 
+/**
+ * \return the number of heap allocations made by the library buffers, i.e.
+ * aligned_malloc, aligned_realloc and the allocations reported with
+ * RecordAllocation. Useful to check that steady-state tracking does not
+ * allocate. The allocations made elsewhere, e.g. inside OpenCV, are not
+ * counted
+ */
+size_t GetAllocationCount();
+
+/**
+ * records an allocation made outside of aligned_malloc (e.g. a cv::Mat buffer)
+ */
+void RecordAllocation();
+
 template <class T, int Alignment = TT_DEFAULT_ALIGNMENT>
 class AlignedAllocator;
 
@@ -169,6 +185,75 @@ template <typename T, int TAlign, typename U, int UAlign> inline
 bool operator!=(const AlignedAllocator<T, TAlign>&,
                 const AlignedAllocator<U, UAlign>&) { return TAlign != UAlign; }
 
+/**
+ * A bump allocator over a single aligned block. Memory is handed out with
+ * allocate() and released all at once with reset().
+ *
+ * If the allocations do not fit, the extra memory is taken from the heap and
+ * the block is grown to the high-water mark at the next reset(). Hence, once
+ * the arena has seen the working set, there are no more heap allocations
+ */
+class Arena
+{
+ public:
+  /**
+   * \param nbytes initial capacity
+   */
+  explicit Arena(size_t nbytes = 0);
+
+  /**
+   * The copy has the same capacity, but not the contents
+   */
+  Arena(const Arena&);
+  Arena& operator=(const Arena&);
+
+  Arena(Arena&&) noexcept;
+  Arena& operator=(Arena&&) noexcept;
+
+  ~Arena();
+
+  /**
+   * makes sure the capacity is at least 'nbytes'. If the arena grows, previous
+   * allocations are invalidated
+   */
+  void reserve(size_t nbytes);
+
+  /**
+   * \return memory for 'n' elements of type T, aligned to TT_DEFAULT_ALIGNMENT.
+   * Constructors are not called
+   */
+  template <class T> inline T* allocate(size_t n)
+  {
+    return reinterpret_cast<T*>( allocateBytes(n * sizeof(T)) );
+  }
+
+  /**
+   * releases all the allocations
+   */
+  void reset();
+
+  inline size_t capacity() const { return _capacity; }
+  inline size_t used() const { return _used; }
+
+  /**
+   * \return the number of bytes needed to allocate 'nbytes' from the arena,
+   * i.e. 'nbytes' rounded up to the alignment. Useful to size the arena
+   */
+  static inline size_t AlignedSize(size_t nbytes)
+  {
+    return (nbytes + TT_DEFAULT_ALIGNMENT - 1) & ~size_t(TT_DEFAULT_ALIGNMENT - 1);
+  }
+
+ private:
+  void* allocateBytes(size_t);
+  void release();
+
+  uint8_t* _data;
+  size_t _capacity;
+  size_t _used;                 //< bytes in use, including the overflow
+  std::vector<void*> _overflow; //< heap allocations that did not fit
+}; // Arena
+
 }; // bp
 
 #endif // BITPLANES_UTILS_MEMORY_H
@@ -18,6 +18,7 @@
 #include "bitplanes/utils/str2num.h"
 #include "bitplanes/utils/icompare.h"
 
+#include <sstream>
 #include <stdexcept>
 
 namespace bp {
@@ -46,5 +47,16 @@ template <> bool str2num<bool>(const std::string& s)
   }
 }
 
+std::vector<std::string> splitstr(const std::string& str, char delim)
+{
+  std::vector<std::string> ret;
+  std::istringstream ss(str);
+  std::string token;
+  while(std::getline(ss, token, delim))
+    ret.push_back(token);
+
+  return ret;
+}
+
 } // bp
 